@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL 0x43                        /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL)) /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -80,3 +77,42 @@ void pit_configure_channel(int channel, int mode, int frequency)
     outb(PIT_PORT_COUNTER(channel), count >> 8);
     intr_set_level(old_level);
 }
+
+/* Starts CHANNEL counting down from COUNT in mode 0, which raises
+   the channel's output once, when the count runs out, and then
+   leaves it alone.  Channel 0 thus interrupts once.  COUNT must be
+   nonzero. */
+void pit_start_oneshot(int channel, uint16_t count)
+{
+    enum intr_level old_level;
+
+    ASSERT(channel == 0 || channel == 2);
+    ASSERT(count != 0);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
+
+/* Stores the current count of CHANNEL in *COUNT and returns the
+   channel's output, which in mode 0 is true once the count has run
+   out.  Uses the read-back command, which latches the status and
+   the count together. */
+bool pit_read_count(int channel, uint16_t *count)
+{
+    enum intr_level old_level;
+    uint8_t status;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, 0xc0 | (1 << (channel + 1)));
+    status = inb(PIT_PORT_COUNTER(channel));
+    *count = inb(PIT_PORT_COUNTER(channel));
+    *count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+    intr_set_level(old_level);
+
+    return (status & 0x80) != 0;
+}
@@ -5,14 +5,23 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/schedtrace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/pagedir.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/vmstat.h"
+#include "vm/writeback.h"
+#include "vm/zswap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -123,6 +132,8 @@ print_stats(void)
 {
     timer_print_stats();
     thread_print_stats();
+    lock_print_stats();
+    schedtrace_print();
 #ifdef FILESYS
     block_print_stats();
 #endif
@@ -130,5 +141,13 @@ print_stats(void)
     kbd_print_stats();
 #ifdef USERPROG
     exception_print_stats();
+    pagedir_print_stats();
+#endif
+#ifdef VM
+    swap_print_stats();
+    zswap_print_stats();
+    share_print_stats();
+    writeback_print_stats();
+    vmstat_print_stats();
 #endif
 }
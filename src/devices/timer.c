@@ -24,7 +24,72 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Pending timers, in a hierarchical timing wheel.
+
+   Level 0 has a slot for each of the next WHEEL_SIZE ticks.  Each
+   slot of level N covers WHEEL_SIZE times as many ticks as a slot
+   of level N - 1.  A timer goes in the lowest level whose range
+   reaches its deadline.  When the slot of level 0 for the current
+   tick wraps around to the start, the next slot of level 1 is
+   cascaded, that is, its timers are put back in the wheel, landing
+   a level lower.  The same goes for the higher levels.
+
+   Adding or cancelling a timer is O(1).  Each tick only the timers
+   in one slot of level 0 expire, plus the timers of a cascaded slot
+   every WHEEL_SIZE ticks.  Deadlines beyond the top level wait in
+   its last slot and are put back in each time it cascades.
+
+   Interrupts must be off while touching the wheel. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_RANGE (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* One-shot operation.
+
+   Normally the PIT interrupts once a tick.  It is switched to
+   one-shot mode, which interrupts once after a given count, in two
+   cases.  When the CPU goes idle with nothing due for a few ticks,
+   it can sleep through them.  When a thread sleeps for less than a
+   tick, it can block until the PIT goes off mid-tick rather than
+   spin.  Either way the PIT goes back to periodic mode at the next
+   tick boundary with nothing left to wait for.
+
+   Time within a tick is kept in PIT counts, TICK_COUNTS per tick.
+   The 16-bit counter limits one idle stretch to IDLE_MAX_TICKS.
+
+   Interrupts must be off while touching these. */
+#define TICK_COUNTS ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define IDLE_MAX_TICKS (UINT16_MAX / TICK_COUNTS)
+static bool oneshot;            /* PIT in one-shot mode? */
+static bool oneshot_idle;       /* Armed by the idle thread? */
+static int64_t oneshot_start;   /* Clock when armed, in PIT counts. */
+static unsigned oneshot_counts; /* Counts from then until it goes off. */
+static struct list hires_list;  /* Sub-tick sleepers, by deadline. */
+
+/* A thread in a sub-tick sleep. */
+struct hires_sleeper
+{
+    int64_t deadline; /* Clock to wake at, in PIT counts. */
+    struct thread *thread;
+    struct list_elem elem;
+};
+
+/* Statistics. */
+static int64_t interrupt_cnt; /* Timer interrupts taken. */
+
 static intr_handler_func timer_interrupt;
+static void run_tick(void);
+static void wheel_insert(struct timer *, int64_t now);
+static void wheel_cascade(int level, int64_t now);
+static void wake_sleeper(void *);
+static int64_t clock_now(void);
+static void clock_advance(int64_t now);
+static void arm_oneshot(int64_t now, int64_t deadline);
+static void hires_sleep(int64_t deadline);
+static bool hires_less(const struct list_elem *, const struct list_elem *, void *aux);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -34,6 +99,13 @@ static void real_time_delay(int64_t num, int32_t denom);
    and registers the corresponding interrupt. */
 void timer_init(void)
 {
+    int level, slot;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (slot = 0; slot < WHEEL_SIZE; slot++)
+            list_init(&wheel[level][slot]);
+    list_init(&hires_list);
+
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -86,26 +158,17 @@ timer_elapsed(int64_t then)
    be turned on. */
 void timer_sleep(int64_t ticks)
 {
-    ASSERT(intr_get_level() == INTR_ON);
     struct thread *cur = thread_current();
-    // enum intr_level old_level;
-    // old_level = intr_disable();
-
-    if (cur != get_idle())
-    {
-        int64_t start = timer_ticks();
-        int64_t wakeup_tick = start + ticks;
-        struct thread *t = thread_current();
-        t->wakeup_tick = wakeup_tick;
-
-        struct list *sleep_list = get_sleep_list();
-        list_insert_ordered(sleep_list, &t->elem, late, NULL);
+    enum intr_level old_level;
 
-        thread_block_without_intr();
-        // thread_block();
-    }
+    ASSERT(intr_get_level() == INTR_ON);
+    if (ticks <= 0 || cur == get_idle())
+        return;
 
-    // intr_set_level(old_level);
+    old_level = intr_disable();
+    timer_add(&cur->sleep_timer, ticks + timer_ticks(), wake_sleeper, cur);
+    thread_block();
+    intr_set_level(old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -129,6 +192,78 @@ void timer_nsleep(int64_t ns)
     real_time_sleep(ns, 1000 * 1000 * 1000);
 }
 
+/* Arranges for FUNC to be called with AUX from the timer interrupt
+   at tick DEADLINE, or at the next tick if DEADLINE has passed.
+   TIMER must not be pending already. */
+void timer_add(struct timer *timer, int64_t deadline, timer_func *func, void *aux)
+{
+    enum intr_level old_level = intr_disable();
+
+    ASSERT(!timer->pending);
+    timer->deadline = deadline > ticks ? deadline : ticks + 1;
+    timer->func = func;
+    timer->aux = aux;
+    timer->pending = true;
+    wheel_insert(timer, ticks);
+
+    intr_set_level(old_level);
+}
+
+/* Cancels TIMER.  Returns true if it was pending, false if its
+   function has already been called or it was never added. */
+bool timer_cancel(struct timer *timer)
+{
+    enum intr_level old_level = intr_disable();
+    bool was_pending = timer->pending;
+
+    if (was_pending)
+    {
+        list_remove(&timer->elem);
+        timer->pending = false;
+    }
+
+    intr_set_level(old_level);
+    return was_pending;
+}
+
+/* Lets the idle thread sleep through the ticks with nothing due,
+   by setting the PIT to go off at the first tick that has work.
+   Called with interrupts off just before the CPU halts. */
+void timer_idle_enter(void)
+{
+    int64_t next, limit;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    if (oneshot)
+        return;
+
+    /* Timers in the upper levels of the wheel are due no earlier
+       than the next cascade, so only level 0 needs a look. */
+    limit = (ticks | WHEEL_MASK) + 1;
+    if (limit > ticks + IDLE_MAX_TICKS)
+        limit = ticks + IDLE_MAX_TICKS;
+    for (next = ticks + 1; next < limit; next++)
+        if (!list_empty(&wheel[0][next & WHEEL_MASK]))
+            break;
+
+    if (next > ticks + 1)
+    {
+        arm_oneshot(clock_now(), next * TICK_COUNTS);
+        oneshot_idle = true;
+    }
+}
+
+/* Catches up on the ticks slept through by the idle thread when
+   another interrupt wakes the CPU first.  Called at the start of
+   every external interrupt. */
+void timer_irq_enter(void)
+{
+    uint16_t count;
+
+    if (oneshot_idle && !pit_read_count(0, &count))
+        clock_advance(oneshot_start + oneshot_counts - count);
+}
+
 /* Busy-waits for approximately MS milliseconds.  Interrupts need
    not be turned on.
 
@@ -165,50 +300,211 @@ void timer_ndelay(int64_t ns)
     real_time_delay(ns, 1000 * 1000 * 1000);
 }
 
+/* Returns the CPU's time stamp counter, which counts clock
+   cycles. */
+uint64_t timer_cycles(void)
+{
+    uint64_t tsc;
+    asm volatile("rdtsc"
+                 : "=A"(tsc));
+    return tsc;
+}
+
 /* Prints timer statistics. */
 void timer_print_stats(void)
 {
-    printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+    printf("Timer: %" PRId64 " ticks, %" PRId64 " interrupts\n",
+           timer_ticks(), interrupt_cnt);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt(struct intr_frame *args UNUSED)
+{
+    uint16_t count;
+
+    interrupt_cnt++;
+    if (!oneshot)
+        run_tick();
+    else if (!pit_read_count(0, &count))
+    {
+        /* A periodic tick that came due just before the PIT was
+           switched to one-shot mode, so that clock_now() read a
+           tick short.  Count the tick and move the one-shot along
+           with the clock. */
+        run_tick();
+        oneshot_start += TICK_COUNTS;
+    }
+    else
+        clock_advance(oneshot_start + oneshot_counts);
+}
+
+/* Starts a new tick and does the work due in it. */
+static void
+run_tick(void)
 {
     ticks++;
     thread_tick();
 
     if (thread_mlfqs)
+        thread_mlfqs_tick(ticks);
+
+    /* Bring the timers due this tick down to level 0, then run
+       them.  A function may add timers, but never for this tick. */
+    struct list *due = &wheel[0][ticks & WHEEL_MASK];
+    int level;
+
+    for (level = 1; level < WHEEL_LEVELS && (ticks & ((1LL << (WHEEL_BITS * level)) - 1)) == 0; level++)
+        wheel_cascade(level, ticks);
+
+    while (!list_empty(due))
     {
-        update_recent_cpu();
+        struct timer *timer = list_entry(list_pop_front(due), struct timer, elem);
+        ASSERT(timer->deadline == ticks);
+        timer->pending = false;
+        timer->func(timer->aux);
+    }
+}
 
-        if (timer_ticks() % TIMER_FREQ == 0)
-        {
-            update_load_avg();
-            thread_foreach(realloc_recent_cpu, NULL);
-        }
+/* Puts TIMER in its slot of the wheel, given that the wheel has
+   expired every tick up to NOW.  TIMER's deadline must not be
+   before NOW. */
+static void
+wheel_insert(struct timer *timer, int64_t now)
+{
+    int64_t deadline = timer->deadline;
+    int level;
+
+    ASSERT(deadline >= now);
+    if (deadline - now >= WHEEL_RANGE)
+        deadline = now + WHEEL_RANGE - 1;
+
+    for (level = 0; level < WHEEL_LEVELS - 1; level++)
+        if (deadline - now < 1LL << (WHEEL_BITS * (level + 1)))
+            break;
+
+    list_push_back(&wheel[level][(deadline >> (WHEEL_BITS * level)) & WHEEL_MASK], &timer->elem);
+}
+
+/* Puts the timers in the slot of LEVEL that NOW falls in back in
+   the wheel, which moves them to lower levels. */
+static void
+wheel_cascade(int level, int64_t now)
+{
+    struct list *slot = &wheel[level][(now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    struct list timers;
+
+    list_init(&timers);
+    while (!list_empty(slot))
+        list_push_back(&timers, list_pop_front(slot));
+    while (!list_empty(&timers))
+        wheel_insert(list_entry(list_pop_front(&timers), struct timer, elem), now);
+}
+
+/* Wakes the thread that set its sleep timer in timer_sleep(). */
+static void
+wake_sleeper(void *t)
+{
+    thread_unblock(t);
+}
+
+/* Returns the time since boot in PIT counts. */
+static int64_t
+clock_now(void)
+{
+    uint16_t count;
+    bool out = pit_read_count(0, &count);
+
+    /* In periodic mode the count runs from TICK_COUNTS down to 1. */
+    if (!oneshot)
+        return ticks * TICK_COUNTS + (TICK_COUNTS - count);
+    return oneshot_start + oneshot_counts - (out ? 0 : count);
+}
+
+/* Brings the clock up to NOW after the PIT has been in one-shot
+   mode: runs the ticks that passed, wakes the sub-tick sleepers that
+   are due and sets the PIT for what comes next.  Must be called in
+   an external interrupt context. */
+static void
+clock_advance(int64_t now)
+{
+    int64_t boundary;
+
+    ASSERT(intr_context());
+    oneshot = oneshot_idle = false;
 
-        if (timer_ticks() % 4 == 0)
-            thread_foreach(realloc_priority, NULL);
+    while (ticks < now / TICK_COUNTS)
+        run_tick();
+
+    while (!list_empty(&hires_list))
+    {
+        struct hires_sleeper *s = list_entry(list_front(&hires_list), struct hires_sleeper, elem);
+        if (s->deadline > now)
+            break;
+        list_pop_front(&hires_list);
+        thread_unblock(s->thread);
     }
 
-    struct list *sleep_list = get_sleep_list();
-    struct list_elem *e = list_begin(sleep_list);
-    while (e != list_end(sleep_list))
+    boundary = (ticks + 1) * TICK_COUNTS;
+    if (!list_empty(&hires_list))
     {
-        struct list_elem *next = list_next(e);
-        struct thread *t = list_entry(e, struct thread, elem);
+        struct hires_sleeper *s = list_entry(list_front(&hires_list), struct hires_sleeper, elem);
+        arm_oneshot(now, s->deadline < boundary ? s->deadline : boundary);
+    }
+    else if (now % TICK_COUNTS != 0)
+        arm_oneshot(now, boundary);
+    else
+        pit_configure_channel(0, 2, TIMER_FREQ);
+}
 
-        if (t->wakeup_tick <= ticks)
-        {
-            list_remove(e);
-            thread_unblock(t);
-        }
-        else
-            break;
+/* Sets the PIT to go off once, at clock DEADLINE, given that the
+   clock reads NOW. */
+static void
+arm_oneshot(int64_t now, int64_t deadline)
+{
+    ASSERT(deadline > now && deadline - now <= UINT16_MAX);
+
+    oneshot = true;
+    oneshot_start = now;
+    oneshot_counts = deadline - now;
+    pit_start_oneshot(0, oneshot_counts);
+}
 
-        e = next;
+/* Blocks the current thread until clock DEADLINE, which must fall
+   within the current tick.  Interrupts must be off. */
+static void
+hires_sleep(int64_t deadline)
+{
+    struct hires_sleeper s;
+    int64_t now = clock_now();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(deadline <= (ticks + 1) * TICK_COUNTS);
+    if (deadline <= now)
+        return;
+
+    s.deadline = deadline;
+    s.thread = thread_current();
+    list_insert_ordered(&hires_list, &s.elem, hires_less, NULL);
+
+    /* Go off earlier if this is the first sleeper due, unless the
+       PIT already has and its interrupt is waiting. */
+    if (list_front(&hires_list) == &s.elem && (!oneshot || deadline < oneshot_start + oneshot_counts))
+    {
+        uint16_t count;
+        if (!oneshot || !pit_read_count(0, &count))
+            arm_oneshot(now, deadline);
     }
+    thread_block();
+}
+
+static bool
+hires_less(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
+{
+    const struct hires_sleeper *a = list_entry(a_, struct hires_sleeper, elem);
+    const struct hires_sleeper *b = list_entry(b_, struct hires_sleeper, elem);
+
+    return a->deadline < b->deadline;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -266,9 +562,26 @@ real_time_sleep(int64_t num, int32_t denom)
     }
     else
     {
-        /* Otherwise, use a busy-wait loop for more accurate
-           sub-tick timing. */
-        real_time_delay(num, denom);
+        /* Otherwise, block until the PIT goes off at the exact
+           time, sleeping through to the right tick first if the
+           wait crosses a tick boundary. */
+        int64_t deadline;
+        enum intr_level old_level = intr_disable();
+
+        deadline = clock_now() + num * PIT_HZ / denom;
+        while (deadline > clock_now())
+        {
+            if (deadline > (ticks + 1) * TICK_COUNTS)
+            {
+                int64_t wait = deadline / TICK_COUNTS - ticks;
+                intr_set_level(old_level);
+                timer_sleep(wait);
+                intr_disable();
+            }
+            else
+                hires_sleep(deadline);
+        }
+        intr_set_level(old_level);
     }
 }
 
@@ -1,17 +1,37 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* A function called from the timer interrupt once a deadline
+   passes.  Runs in an external interrupt context, so it must not
+   sleep. */
+typedef void timer_func(void *aux);
+
+/* A pending call to FUNC with AUX at tick DEADLINE.  The owner
+   provides the storage, which must stay put until the call is made
+   or the timer is cancelled. */
+struct timer
+{
+    int64_t deadline;
+    timer_func *func;
+    void *aux;
+    bool pending;
+    struct list_elem elem; /* Timer wheel slot. */
+};
+
 void timer_init(void);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
+uint64_t timer_cycles(void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
@@ -19,6 +39,14 @@ void timer_msleep(int64_t milliseconds);
 void timer_usleep(int64_t microseconds);
 void timer_nsleep(int64_t nanoseconds);
 
+/* Kernel timers. */
+void timer_add(struct timer *, int64_t deadline, timer_func *, void *aux);
+bool timer_cancel(struct timer *);
+
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_irq_enter(void);
+
 /* Busy waits. */
 void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
@@ -0,0 +1,51 @@
+/* tlbmult.c
+
+   Matrix multiplication that walks B by columns, touching a
+   different page on almost every access, to compare small and
+   large page mappings.  The matrices sit in one 4 MB aligned,
+   zero-filled block, which the kernel can back with a single
+   large page.  Compare the "Timer:" and "Paging:" lines of
+
+     pintos -m 16 -- -q run tlbmult
+     pintos -m 16 -- -q -pse run tlbmult
+
+   The second should take fewer ticks. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+#define DIM 256
+#define LARGE_PAGE (4 * 1024 * 1024)
+
+struct matrices
+  {
+    int A[DIM][DIM];
+    int B[DIM][DIM];
+    int C[DIM][DIM];
+    char pad[LARGE_PAGE - 3 * DIM * DIM * sizeof (int)];
+  };
+
+static struct matrices m __attribute__ ((aligned (LARGE_PAGE)));
+
+int
+main (void)
+{
+  int i, j, k;
+
+  /* Initialize the matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+	m.A[i][j] = i;
+	m.B[i][j] = j;
+      }
+
+  /* Multiply matrices, B column by column. */
+  for (j = 0; j < DIM; j++)
+    for (i = 0; i < DIM; i++)
+      for (k = 0; k < DIM; k++)
+	m.C[i][j] += m.A[i][k] * m.B[k][j];
+
+  /* Done. */
+  exit (m.C[DIM - 1][DIM - 1]);
+}
@@ -4,7 +4,19 @@
 #include "threads/malloc.h"
 #include "threads/synch.h"
 
+/* Signaled when an entry's last pin is dropped. */
+static struct condition bc_unpinned;
+
+/* Classes for the statistics.  The cache lock is only held to find
+   or remap an entry; disk I/O happens under the entry's own lock. */
+static struct lock_class cache_lock_class = LOCK_CLASS_INITIALIZER("buffer cache", LOCK_SPIN_SHORT);
+static struct lock_class entry_lock_class = LOCK_CLASS_INITIALIZER("buffer entry", 0);
+
 static struct buffer_head *bc_find_empty(void);
+static struct buffer_head *bc_get(block_sector_t sector);
+static void bc_put(struct buffer_head *bh);
+static void bc_unpin(struct buffer_head *bh);
+static void bc_writeback(struct buffer_head *bh);
 
 void bc_init(void)
 {
@@ -18,12 +30,16 @@ void bc_init(void)
         bh = malloc(sizeof(struct buffer_head));
         bh->dirty = 0;
         bh->accessed = 0;
+        bh->valid = false;
+        bh->pin_cnt = 0;
         bh->sector = -1;
         bh->data = buffer_cache + i * BLOCK_SECTOR_SIZE;
+        lock_init_class(&bh->lock, &entry_lock_class);
         buffer_haed[i] = bh;
     }
 
-    lock_init(&buffer_cache_lock);
+    lock_init_class(&buffer_cache_lock, &cache_lock_class);
+    cond_init(&bc_unpinned);
     clock_head = 0;
 }
 
@@ -42,59 +58,109 @@ void bc_free(void)
 
 void bc_read(block_sector_t sector_idx, void *buffer, off_t bytes_read, int chunk_size, int sector_ofs)
 {
-    lock_acquire(&buffer_cache_lock);
-
-    struct buffer_head *bh = bc_lookup(sector_idx);
-    if (bh == NULL)
-    {
-        bh = bc_find_empty();
-        if (bh == NULL)
-        {
-            bh = bc_find_victim();
-            bc_flush(bh);
-        }
-        /* Read data from disk to buffer cache. */
-        block_read(fs_device, sector_idx, bh->data);
-        bh->sector = sector_idx;
-    }
+    struct buffer_head *bh = bc_get(sector_idx);
 
     /* Read data from buffer cache to buffer. */
     memcpy(buffer + bytes_read, bh->data + sector_ofs, chunk_size);
 
-    /* Update buffer head. */
-    bh->accessed = 1;
-
-    lock_release(&buffer_cache_lock);
+    bc_put(bh);
 }
 
 void bc_write(block_sector_t sector_idx, void *buffer, off_t bytes_written, int chunk_size, int sector_ofs)
 {
-    lock_acquire(&buffer_cache_lock);
+    struct buffer_head *bh = bc_get(sector_idx);
+
+    /* Write data from buffer to buffer cache. */
+    memcpy(bh->data + sector_ofs, buffer + bytes_written, chunk_size);
+    bh->dirty = 1;
 
-    struct buffer_head *bh = bc_lookup(sector_idx);
-    if (bh == NULL)
+    bc_put(bh);
+}
+
+/* Returns the entry caching SECTOR, pinned and locked, reading the
+   sector in if it is not cached.  Release it with bc_put(). */
+static struct buffer_head *bc_get(block_sector_t sector)
+{
+    struct buffer_head *bh;
+
+    lock_acquire(&buffer_cache_lock);
+    for (;;)
     {
+        bh = bc_lookup(sector);
+        if (bh != NULL)
+            break;
+
         bh = bc_find_empty();
         if (bh == NULL)
-        {
             bh = bc_find_victim();
-            bc_flush(bh);
+        if (bh == NULL)
+        {
+            /* Every entry is in use. */
+            cond_wait(&bc_unpinned, &buffer_cache_lock);
+            continue;
         }
-        /* Read data from disk to buffer cache. */
-        block_read(fs_device, sector_idx, bh->data);
-        bh->sector = sector_idx;
-    }
 
-    /* Read data from buffer cache to buffer. */
-    memcpy(bh->data + sector_ofs, buffer + bytes_written, chunk_size);
+        if (!bh->dirty)
+        {
+            bh->sector = sector;
+            bh->valid = false;
+            break;
+        }
 
-    /* Update buffer head. */
-    bh->dirty = 1;
+        /* Write the victim back while it still answers for its own
+           sector, then look again: meanwhile another thread may
+           have brought SECTOR in or dirtied the victim anew. */
+        bh->pin_cnt++;
+        lock_release(&buffer_cache_lock);
+        lock_acquire(&bh->lock);
+        bc_writeback(bh);
+        lock_release(&bh->lock);
+        lock_acquire(&buffer_cache_lock);
+        bc_unpin(bh);
+    }
+    bh->pin_cnt++;
     bh->accessed = 1;
+    lock_release(&buffer_cache_lock);
+
+    lock_acquire(&bh->lock);
+    if (!bh->valid)
+    {
+        /* Read data from disk to buffer cache. */
+        block_read(fs_device, sector, bh->data);
+        bh->valid = true;
+    }
+    return bh;
+}
+
+/* Releases entry BH obtained from bc_get(). */
+static void bc_put(struct buffer_head *bh)
+{
+    lock_release(&bh->lock);
 
+    lock_acquire(&buffer_cache_lock);
+    bc_unpin(bh);
     lock_release(&buffer_cache_lock);
 }
 
+/* Drops a pin on BH.  Must be called with buffer_cache_lock held. */
+static void bc_unpin(struct buffer_head *bh)
+{
+    ASSERT(bh->pin_cnt > 0);
+    if (--bh->pin_cnt == 0)
+        cond_signal(&bc_unpinned, &buffer_cache_lock);
+}
+
+/* Writes BH back to disk if it is dirty.  Must be called with BH's
+   lock held. */
+static void bc_writeback(struct buffer_head *bh)
+{
+    if (bh->dirty)
+    {
+        block_write(fs_device, bh->sector, bh->data);
+        bh->dirty = 0;
+    }
+}
+
 struct buffer_head *bc_lookup(block_sector_t sector)
 {
     struct buffer_head *bh;
@@ -119,37 +185,59 @@ static struct buffer_head *bc_find_empty(void)
     return NULL;
 }
 
+/* Picks an unpinned entry to reuse by the clock algorithm, or
+   returns a null pointer if every entry is pinned.  Must be called
+   with buffer_cache_lock held. */
 struct buffer_head *bc_find_victim(void)
 {
-    struct buffer_head *bh;
-    while (true)
+    /* The first sweep may only clear accessed bits. */
+    for (int n = 0; n < 2 * BUFFER_CACHE_ENTRY_SIZE; n++)
     {
         if (clock_head >= BUFFER_CACHE_ENTRY_SIZE)
             clock_head = 0;
 
-        for (int i = clock_head; i < BUFFER_CACHE_ENTRY_SIZE; i++)
-        {
-            bh = buffer_haed[i];
-            if (!bh->accessed)
-            {
-                clock_head = i + 1;
-                return bh;
-            }
-            else
-                bh->accessed = false;
-        }
+        struct buffer_head *bh = buffer_haed[clock_head++];
+        if (bh->pin_cnt > 0)
+            continue;
+        if (!bh->accessed)
+            return bh;
+        bh->accessed = false;
     }
+    return NULL;
 }
 
 void bc_flush(struct buffer_head *bh)
 {
     /* Flush victim entry to disk. */
-    if (bh->dirty)
-        block_write(fs_device, bh->sector, bh->data);
+    bc_writeback(bh);
 
     /* Release victim entry from buffer head. */
-    bh->dirty = 0;
     bh->accessed = 0;
+    bh->valid = false;
     bh->sector = -1;
     memset(bh->data, 0, BLOCK_SECTOR_SIZE);
 }
+
+/* Writes every dirty entry back to disk, keeping it cached. */
+void bc_sync(void)
+{
+    for (int i = 0; i < BUFFER_CACHE_ENTRY_SIZE; i++)
+    {
+        struct buffer_head *bh = buffer_haed[i];
+
+        /* Pin the entry so that it keeps its sector during the
+           write. */
+        lock_acquire(&buffer_cache_lock);
+        if (!bh->dirty)
+        {
+            lock_release(&buffer_cache_lock);
+            continue;
+        }
+        bh->pin_cnt++;
+        lock_release(&buffer_cache_lock);
+
+        lock_acquire(&bh->lock);
+        bc_writeback(bh);
+        bc_put(bh);
+    }
+}
@@ -7,12 +7,19 @@
 
 #define BUFFER_CACHE_ENTRY_SIZE 64
 
+/* A cache entry.  BUFFER_CACHE_LOCK guards SECTOR, ACCESSED and
+   PIN_CNT; LOCK guards DATA, VALID and DIRTY.  An entry is only
+   remapped to another sector while unpinned, so I/O on one entry
+   runs without holding up lookups of the others. */
 struct buffer_head
 {
     bool dirty;
     bool accessed;
+    bool valid;            /* DATA holds SECTOR's contents. */
+    int pin_cnt;           /* Users between lookup and release. */
     block_sector_t sector;
     void *data;
+    struct lock lock;
 };
 
 struct buffer_head *buffer_haed[BUFFER_CACHE_ENTRY_SIZE];
@@ -30,5 +37,6 @@ void bc_write(block_sector_t sector_idx, void *buffer, off_t bytes_written, int
 struct buffer_head *bc_lookup(block_sector_t sector);
 struct buffer_head *bc_find_victim(void);
 void bc_flush(struct buffer_head *bh);
+void bc_sync(void);
 
 #endif
@@ -4,13 +4,17 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file; /* Free map file. */
 static struct bitmap *free_map;    /* Free map, one bit per sector. */
+static struct lock free_map_lock;  /* Guards FREE_MAP and its file. */
+static struct lock_class free_map_lock_class = LOCK_CLASS_INITIALIZER("free map", 0);
 
 /* Initializes the free map. */
 void free_map_init(void)
 {
+    lock_init_class(&free_map_lock, &free_map_lock_class);
     free_map = bitmap_create(block_size(fs_device));
     if (free_map == NULL)
         PANIC("bitmap creation failed--file system device is too large");
@@ -25,12 +29,14 @@ void free_map_init(void)
    written. */
 bool free_map_allocate(size_t cnt, block_sector_t *sectorp)
 {
+    lock_acquire(&free_map_lock);
     block_sector_t sector = bitmap_scan_and_flip(free_map, 0, cnt, false);
     if (sector != BITMAP_ERROR && free_map_file != NULL && !bitmap_write(free_map, free_map_file))
     {
         bitmap_set_multiple(free_map, sector, cnt, false);
         sector = BITMAP_ERROR;
     }
+    lock_release(&free_map_lock);
     if (sector != BITMAP_ERROR)
         *sectorp = sector;
     return sector != BITMAP_ERROR;
@@ -39,9 +45,11 @@ bool free_map_allocate(size_t cnt, block_sector_t *sectorp)
 /* Makes CNT sectors starting at SECTOR available for use. */
 void free_map_release(block_sector_t sector, size_t cnt)
 {
+    lock_acquire(&free_map_lock);
     ASSERT(bitmap_all(free_map, sector, cnt));
     bitmap_set_multiple(free_map, sector, cnt, false);
     bitmap_write(free_map, free_map_file);
+    lock_release(&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -111,6 +111,9 @@ byte_to_sector(const struct inode_disk *inode_disk, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Class of the write side of every inode_lock. */
+static struct lock_class inode_lock_class = LOCK_CLASS_INITIALIZER("inode", 0);
+
 /* Initializes the inode module. */
 void inode_init(void)
 {
@@ -183,7 +186,7 @@ inode_open(block_sector_t sector)
     inode->open_cnt = 1;
     inode->deny_write_cnt = 0;
     inode->removed = false;
-    lock_init(&inode->inode_lock);
+    rwlock_init_class(&inode->inode_lock, &inode_lock_class);
     return inode;
 }
 
@@ -251,6 +254,12 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
     uint8_t *bounce = NULL;
 
     struct inode_disk *inode_disk = malloc(BLOCK_SECTOR_SIZE);
+    if (inode_disk == NULL)
+        return bytes_read;
+
+    /* Readers share the inode; an extending writer excludes them
+       until the new sectors are in place. */
+    rwlock_acquire_read(&inode->inode_lock);
     get_disk_inode(inode, inode_disk);
 
     while (size > 0)
@@ -263,7 +272,7 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
         int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
         /* Bytes left in inode, bytes left in sector, lesser of the two. */
-        off_t inode_left = inode_length(inode) - offset;
+        off_t inode_left = inode_disk->length - offset;
         int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
         int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -280,6 +289,7 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
         offset += chunk_size;
         bytes_read += chunk_size;
     }
+    rwlock_release_read(&inode->inode_lock);
     free(inode_disk);
 
     return bytes_read;
@@ -304,20 +314,26 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
     if (disk_inode == NULL)
         return bytes_written;
 
+    /* Writes within the file share the inode with readers and with
+       each other, the cache keeping each sector consistent.  Only a
+       write that grows the file needs it to itself. */
+    bool extending = offset + size > inode_length(inode);
+    if (extending)
+        rwlock_acquire_write(&inode->inode_lock);
+    else
+        rwlock_acquire_read(&inode->inode_lock);
     get_disk_inode(inode, disk_inode);
 
-    lock_acquire(&inode->inode_lock);
-
     int old_length = disk_inode->length;
     int write_end = offset + size;
     if (write_end > old_length)
     {
+        /* Files never shrink, so a write that fit still fits. */
+        ASSERT(extending);
         inode_update_file_length(disk_inode, old_length, write_end);
         bc_write(inode->sector, disk_inode, 0, BLOCK_SECTOR_SIZE, 0);
     }
 
-    lock_release(&inode->inode_lock);
-
     while (size > 0)
     {
         /* Sector to write, starting byte offset within sector. */
@@ -325,7 +341,7 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
         int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
         /* Bytes left in inode, bytes left in sector, lesser of the two. */
-        off_t inode_left = inode_length(inode) - offset;
+        off_t inode_left = disk_inode->length - offset;
         int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
         int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -342,6 +358,10 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
         offset += chunk_size;
         bytes_written += chunk_size;
     }
+    if (extending)
+        rwlock_release_write(&inode->inode_lock);
+    else
+        rwlock_release_read(&inode->inode_lock);
     free(disk_inode);
 
     return bytes_written;
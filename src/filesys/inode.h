@@ -35,7 +35,8 @@ struct inode
     int open_cnt;          /* Number of openers. */
     bool removed;          /* True if deleted, false otherwise. */
     int deny_write_cnt;    /* 0: writes ok, >0: deny writes. */
-    struct lock inode_lock;
+    struct rwlock inode_lock; /* Held to read or write the data; for
+                                 writing only to extend the file. */
 };
 
 void inode_init(void);
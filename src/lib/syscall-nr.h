@@ -28,7 +28,14 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_MMAP_FLAGS,             /* Map a file into memory, with flags. */
+    SYS_MADVISE,                /* Advise on use of mapped memory. */
+    SYS_MSYNC,                  /* Write mapped memory back to its file. */
+    SYS_VMSTAT,                 /* Read VM counters or the fault trace. */
+    SYS_LOCKSTAT                /* Print lock contention statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
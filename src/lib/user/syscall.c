@@ -147,12 +147,42 @@ mmap (int fd, void *addr)
   return syscall2 (SYS_MMAP, fd, addr);
 }
 
+mapid_t
+mmap_flags (int fd, void *addr, int flags)
+{
+  return syscall3 (SYS_MMAP_FLAGS, fd, addr, flags);
+}
+
 void
 munmap (mapid_t mapid)
 {
   syscall1 (SYS_MUNMAP, mapid);
 }
 
+int
+madvise (void *addr, unsigned length, int advice)
+{
+  return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+msync (void *addr, unsigned length, int flags)
+{
+  return syscall3 (SYS_MSYNC, addr, length, flags);
+}
+
+int
+vmstat (int which, void *buffer, unsigned size)
+{
+  return syscall3 (SYS_VMSTAT, which, buffer, size);
+}
+
+void
+lockstat (void)
+{
+  syscall0 (SYS_LOCKSTAT);
+}
+
 bool
 chdir (const char *dir)
 {
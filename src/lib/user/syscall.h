@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <vmstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -12,6 +13,20 @@ typedef int pid_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
+/* Flags for mmap_flags(). */
+#define MAP_POPULATE 0x1        /* Read in the whole mapping now. */
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Random access, no read-ahead. */
+#define MADV_SEQUENTIAL 2       /* Sequential access, full read-ahead. */
+#define MADV_WILLNEED 3         /* Will be accessed soon, read in now. */
+#define MADV_DONTNEED 4         /* Not needed soon, evict first. */
+
+/* Flags for msync(). */
+#define MS_ASYNC 1              /* Leave it to background writeback. */
+#define MS_SYNC 4               /* Write back now and wait. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -36,7 +51,12 @@ void close (int fd);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
+mapid_t mmap_flags (int fd, void *addr, int flags);
 void munmap (mapid_t);
+int madvise (void *addr, unsigned length, int advice);
+int msync (void *addr, unsigned length, int flags);
+int vmstat (int which, void *buffer, unsigned size);
+void lockstat (void);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -0,0 +1,53 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+#include <stdint.h>
+
+/* What vmstat() reads. */
+#define VMSTAT_SELF 0           /* Counters of the calling process. */
+#define VMSTAT_GLOBAL 1         /* Counters summed over all processes. */
+#define VMSTAT_TRACE 2          /* Most recent page faults, oldest first. */
+
+/* Virtual memory event counters. */
+enum vm_counter
+  {
+    VMC_FAULT_BIN,              /* Faults on executable pages. */
+    VMC_FAULT_FILE,             /* Faults on file mappings. */
+    VMC_FAULT_ANON,             /* Faults on stack and swapped pages. */
+    VMC_FAULT_CYCLES,           /* TSC cycles spent handling faults. */
+    VMC_STACK_GROW,             /* Times the stack grew. */
+    VMC_SWAP_IN,                /* Pages read from the swap device. */
+    VMC_SWAP_OUT,               /* Pages written to the swap device. */
+    VMC_ZSWAP_IN,               /* Pages restored from compressed swap. */
+    VMC_ZSWAP_OUT,              /* Pages kept in compressed swap. */
+    VMC_EVICT,                  /* Frames taken away by eviction. */
+    VMC_SCAN,                   /* Frames the clock examined to evict. */
+    VMC_SWAP_SLOTS,             /* Swap slots held now. */
+    VMC_OOM_KILL,               /* Processes killed for lack of memory. */
+    VMC_RSS,                    /* Resident frames at the last sample. */
+    VMC_WSS,                    /* Estimated working set, in pages. */
+    VMC_THROTTLE,               /* Times made to wait while thrashing. */
+    VMC_CNT
+  };
+
+struct vmstat
+  {
+    uint64_t counters[VMC_CNT];
+  };
+
+/* Flags of a traced fault. */
+#define VM_TRACE_WRITE 0x1      /* Write access. */
+#define VM_TRACE_FAILED 0x2     /* Process was killed. */
+
+/* One page fault, as recorded by the tracer. */
+struct vm_trace_event
+  {
+    uint64_t tsc;               /* Time stamp counter at entry. */
+    uint32_t cycles;            /* Cycles spent handling the fault. */
+    uint32_t vaddr;             /* Faulting page. */
+    int tid;                    /* Faulting thread. */
+    uint8_t type;               /* VMC_FAULT_BIN, _FILE or _ANON. */
+    uint8_t flags;              /* VM_TRACE_* flags. */
+  };
+
+#endif /* lib/vmstat.h */
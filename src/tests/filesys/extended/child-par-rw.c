@@ -0,0 +1,50 @@
+/* Child process for par-rw.
+   Reads its file back ROUND_CNT times, checking the contents, and
+   rewrites it in place after each read. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/extended/par-rw.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-par-rw";
+
+static char buf1[FILE_SIZE];
+static char buf2[FILE_SIZE];
+
+int
+main (int argc, const char *argv[])
+{
+  char file_name[16];
+  int child_idx;
+  int fd;
+  int i;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  snprintf (file_name, sizeof file_name, "data%d", child_idx);
+
+  random_init (0);
+  for (i = 0; i <= child_idx; i++)
+    random_bytes (buf1, sizeof buf1);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      seek (fd, 0);
+      CHECK (read (fd, buf2, sizeof buf2) == (int) sizeof buf2,
+             "read \"%s\"", file_name);
+      compare_bytes (buf2, buf1, sizeof buf1, 0, file_name);
+
+      seek (fd, 0);
+      CHECK (write (fd, buf1, sizeof buf1) == (int) sizeof buf1,
+             "write \"%s\"", file_name);
+    }
+  close (fd);
+
+  return child_idx;
+}
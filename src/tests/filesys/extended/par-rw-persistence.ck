@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my (@data) = map (random_bytes (16384), 0 .. 3);
+check_archive ({"child-par-rw" => "tests/filesys/extended/child-par-rw",
+		map (("data$_" => [$data[$_]]), 0 .. 3)});
+pass;
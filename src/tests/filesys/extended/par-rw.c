@@ -0,0 +1,52 @@
+/* Starts several processes that each read and rewrite a file of
+   their own over and over at the same time, and reports the
+   throughput.  Together the files are larger than the buffer
+   cache, so the processes also contend for its entries. */
+
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/extended/par-rw.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[FILE_SIZE];
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  uint64_t start, cycles;
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char file_name[16];
+      int fd;
+
+      snprintf (file_name, sizeof file_name, "data%d", i);
+      random_bytes (buf, sizeof buf);
+      CHECK (create (file_name, 0), "create \"%s\"", file_name);
+      CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+      CHECK (write (fd, buf, sizeof buf) == (int) sizeof buf,
+             "write \"%s\"", file_name);
+      close (fd);
+    }
+
+  start = rdtsc ();
+  exec_children ("child-par-rw", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+  cycles = rdtsc () - start;
+
+  msg ("%llu cycles per kB.",
+       cycles / (2 * CHILD_CNT * ROUND_CNT * FILE_SIZE / 1024));
+}
@@ -0,0 +1,38 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# The cycle count varies from run to run, so only check that it
+# was reported.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+fail "Throughput not reported.\n"
+  if !grep (/^\(par-rw\) \d+ cycles per kB\.$/, @output);
+@output = grep (!/^\(par-rw\) \d+ cycles per kB\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(par-rw) begin
+(par-rw) create "data0"
+(par-rw) open "data0"
+(par-rw) write "data0"
+(par-rw) create "data1"
+(par-rw) open "data1"
+(par-rw) write "data1"
+(par-rw) create "data2"
+(par-rw) open "data2"
+(par-rw) write "data2"
+(par-rw) create "data3"
+(par-rw) open "data3"
+(par-rw) write "data3"
+(par-rw) exec child 1 of 4: "child-par-rw 0"
+(par-rw) exec child 2 of 4: "child-par-rw 1"
+(par-rw) exec child 3 of 4: "child-par-rw 2"
+(par-rw) exec child 4 of 4: "child-par-rw 3"
+(par-rw) wait for child 1 of 4 returned 0 (expected 0)
+(par-rw) wait for child 2 of 4 returned 1 (expected 1)
+(par-rw) wait for child 3 of 4 returned 2 (expected 2)
+(par-rw) wait for child 4 of 4 returned 3 (expected 3)
+(par-rw) end
+EOF
+pass;
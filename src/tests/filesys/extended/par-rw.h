@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_EXTENDED_PAR_RW_H
+#define TESTS_FILESYS_EXTENDED_PAR_RW_H
+
+/* Child I works on file "dataI", which holds the I'th FILE_SIZE
+   bytes of the random stream seeded with 0. */
+#define CHILD_CNT 4
+#define FILE_SIZE 16384
+#define ROUND_CNT 8
+
+#endif /* tests/filesys/extended/par-rw.h */
@@ -0,0 +1,64 @@
+/* Adds kernel timers with deadlines out of order, some far
+   enough away to sit in the upper levels of the timer wheel, and
+   cancels one of them.  Checks that the rest call back in deadline
+   order, no earlier than their deadlines and no later than the tick
+   after. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TIMER_CNT 6
+
+static const int64_t delays[TIMER_CNT] = {300, 5, 70, 130, 20, 64};
+
+static struct timer timers[TIMER_CNT];
+static int64_t fired_at[TIMER_CNT];
+static int order[TIMER_CNT];
+static int fired_cnt;
+static struct semaphore done;
+
+static void
+record (void *aux)
+{
+  int i = (int) aux;
+
+  fired_at[i] = timer_ticks ();
+  order[fired_cnt++] = i;
+  sema_up (&done);
+}
+
+void
+test_alarm_callback (void)
+{
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < TIMER_CNT; i++)
+    timer_add (&timers[i], start + delays[i], record, (void *) i);
+
+  if (!timer_cancel (&timers[3]))
+    fail ("timer 3 should have been pending");
+  msg ("cancelled timer 3");
+
+  for (i = 0; i < TIMER_CNT - 1; i++)
+    sema_down (&done);
+
+  for (i = 0; i < fired_cnt; i++)
+    {
+      int t = order[i];
+      int64_t late = fired_at[t] - (start + delays[t]);
+
+      if (late < 0 || late > 1)
+        fail ("timer %d fired %lld ticks after its deadline", t, late);
+      msg ("timer %d fired after %lld ticks", t, delays[t]);
+    }
+
+  if (timer_cancel (&timers[0]))
+    fail ("timer 0 should have fired already");
+  pass ();
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-callback) begin
+(alarm-callback) cancelled timer 3
+(alarm-callback) timer 1 fired after 5 ticks
+(alarm-callback) timer 4 fired after 20 ticks
+(alarm-callback) timer 5 fired after 64 ticks
+(alarm-callback) timer 2 fired after 70 ticks
+(alarm-callback) timer 0 fired after 300 ticks
+(alarm-callback) PASS
+(alarm-callback) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Sleeps for less than a tick several times, with a lower-priority
+   thread ready to run.  Sub-tick sleeps should block, not spin, so
+   the lower-priority thread gets to run meanwhile, and each should
+   last about as long as asked. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 10
+#define SLEEP_US 2000
+
+static volatile bool done;
+static volatile int64_t spin_cnt;
+
+static void
+spinner (void *aux UNUSED)
+{
+  while (!done)
+    spin_cnt++;
+}
+
+void
+test_alarm_usleep (void)
+{
+  int64_t start, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+
+  start = timer_ticks ();
+  for (i = 0; i < SLEEP_CNT; i++)
+    timer_usleep (SLEEP_US);
+  elapsed = timer_elapsed (start);
+  done = true;
+
+  if (spin_cnt == 0)
+    fail ("lower-priority thread never ran during sub-tick sleeps");
+  msg ("lower-priority thread ran during sub-tick sleeps");
+
+  /* 20 ms is 2 ticks, give or take the tick in progress. */
+  if (elapsed < SLEEP_CNT * SLEEP_US * TIMER_FREQ / 1000000 - 1
+      || elapsed > SLEEP_CNT * SLEEP_US * TIMER_FREQ / 1000000 + 2)
+    fail ("sleeps took %lld ticks", elapsed);
+  pass ();
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) lower-priority thread ran during sub-tick sleeps
+(alarm-usleep) PASS
+(alarm-usleep) end
+EOF
+pass;
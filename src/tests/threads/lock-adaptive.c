@@ -0,0 +1,52 @@
+/* Checks that an adaptive lock is taken without sleeping when its
+   holder is ready to run at the waiter's priority, and that the
+   waiter sleeps, donating its priority, when the holder has a lower
+   priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct lock_class test_class = LOCK_CLASS_INITIALIZER ("test", LOCK_SPIN_SHORT);
+static struct lock lock;
+
+static void
+waiter (void *aux UNUSED)
+{
+  lock_acquire (&lock);
+  msg ("%s acquired the lock", thread_name ());
+  lock_release (&lock);
+}
+
+void
+test_lock_adaptive (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init_class (&lock, &test_class);
+
+  /* The waiter yields back to us instead of sleeping. */
+  lock_acquire (&lock);
+  thread_create ("equal", PRI_DEFAULT, waiter, NULL);
+  thread_yield ();
+  msg ("releasing the lock");
+  lock_release (&lock);
+  thread_yield ();
+  if (test_class.spun_cnt != 1 || test_class.sleep_cnt != 0)
+    fail ("equal priority waiter should not have slept");
+
+  /* The waiter sleeps and lends us its priority. */
+  lock_acquire (&lock);
+  thread_create ("higher", PRI_DEFAULT + 1, waiter, NULL);
+  msg ("priority while holding the lock: %d", thread_get_priority ());
+  lock_release (&lock);
+  if (test_class.sleep_cnt != 1)
+    fail ("higher priority waiter should have slept");
+
+  msg ("%llu acquired, %llu contended", test_class.acquire_cnt,
+       test_class.contend_cnt);
+  pass ();
+}
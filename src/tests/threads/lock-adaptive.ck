@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lock-adaptive) begin
+(lock-adaptive) releasing the lock
+(lock-adaptive) equal acquired the lock
+(lock-adaptive) priority while holding the lock: 32
+(lock-adaptive) higher acquired the lock
+(lock-adaptive) 4 acquired, 2 contended
+(lock-adaptive) PASS
+(lock-adaptive) end
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Checks that the lock profiler charges a contended acquisition's
+   wait to the lock's class, in the totals and in the histogram,
+   and that the holder's hold time covers the wait. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static struct lock_class test_class = LOCK_CLASS_INITIALIZER ("test", 0);
+static struct lock lock;
+
+static void
+waiter (void *aux UNUSED)
+{
+  lock_acquire (&lock);
+  msg ("%s acquired the lock", thread_name ());
+  lock_release (&lock);
+}
+
+void
+test_lock_profile (void)
+{
+  unsigned long long waits = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_profile = true;
+  lock_init_class (&lock, &test_class);
+
+  /* The waiter sleeps on the lock while we hold it for a tick. */
+  lock_acquire (&lock);
+  thread_create ("waiter", PRI_DEFAULT + 1, waiter, NULL);
+  timer_sleep (1);
+  msg ("releasing the lock");
+  lock_release (&lock);
+  lock_profile = false;
+
+  for (i = 0; i < LOCK_HIST_CNT; i++)
+    waits += test_class.wait_hist[i];
+  msg ("%llu acquired, %llu contended, %llu waits in histogram",
+       test_class.acquire_cnt, test_class.contend_cnt, waits);
+
+  if (test_class.max_wait == 0 || test_class.wait_cycles != test_class.max_wait)
+    fail ("the one wait should be the longest and only one");
+  if (test_class.wait_hist[0] != 0)
+    fail ("a wait of a tick should not fall in the shortest bucket");
+  if (test_class.max_hold < test_class.max_wait)
+    fail ("the lock was held for %llu cycles but waited for %llu",
+          test_class.max_hold, test_class.max_wait);
+  pass ();
+}
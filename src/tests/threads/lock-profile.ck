@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lock-profile) begin
+(lock-profile) releasing the lock
+(lock-profile) waiter acquired the lock
+(lock-profile) 2 acquired, 1 contended, 1 waits in histogram
+(lock-profile) PASS
+(lock-profile) end
+EOF
+pass;
@@ -0,0 +1,70 @@
+/* Creates THREAD_CNT threads spread over all priorities above the
+   minimum, which all stay runnable and yield ITER_CNT times each,
+   to measure the cost of the run queue with hundreds of ready
+   threads.  Checks that the threads finish in order of priority
+   and reports the average number of CPU cycles per yield. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 200
+#define ITER_CNT 32
+
+static thread_func yield_thread_func;
+
+static int finished[THREAD_CNT];        /* Priorities in finishing order. */
+static int finish_cnt;
+
+void
+test_priority_bench (void) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("%d threads will yield %d times each.", THREAD_CNT, ITER_CNT);
+
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "bench %d", i);
+      if (thread_create (name, PRI_MIN + 1 + i % (PRI_MAX - PRI_MIN),
+                         yield_thread_func, NULL) == TID_ERROR)
+        fail ("creating thread %d failed.", i);
+    }
+
+  start = timer_cycles ();
+  thread_set_priority (PRI_MIN);
+  /* All the other threads now run to termination here. */
+  cycles = timer_cycles () - start;
+
+  if (finish_cnt != THREAD_CNT)
+    fail ("only %d of %d threads finished.", finish_cnt, THREAD_CNT);
+  for (i = 1; i < THREAD_CNT; i++)
+    if (finished[i] > finished[i - 1])
+      fail ("thread of priority %d finished after one of priority %d.",
+            finished[i], finished[i - 1]);
+  msg ("threads finished in priority order.");
+  msg ("%llu cycles per yield.", cycles / (THREAD_CNT * ITER_CNT));
+}
+
+static void 
+yield_thread_func (void *aux UNUSED) 
+{
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    thread_yield ();
+
+  old_level = intr_disable ();
+  finished[finish_cnt++] = thread_get_priority ();
+  intr_set_level (old_level);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# The cycle count varies from run to run, so only check that it
+# was reported.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+fail "Cycles per yield not reported.\n"
+  if !grep (/^\(priority-bench\) \d+ cycles per yield\.$/, @output);
+@output = grep (!/^\(priority-bench\) \d+ cycles per yield\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(priority-bench) begin
+(priority-bench) 200 threads will yield 32 times each.
+(priority-bench) threads finished in priority order.
+(priority-bench) end
+EOF
+pass;
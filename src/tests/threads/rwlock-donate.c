@@ -0,0 +1,64 @@
+/* The main thread holds a rwlock for reading while a second reader
+   joins it, a writer waits for both, and a reader of still higher
+   priority waits behind the writer.  The writer's priority should
+   pass to the readers, as should the last reader's through the
+   writer, and all of it should be given back on release. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct rwlock rw;
+static struct semaphore second_done;
+
+static void
+second_reader (void *aux UNUSED)
+{
+  rwlock_acquire_read (&rw);
+  msg ("second reader got in alongside the first");
+  sema_down (&second_done);
+  rwlock_release_read (&rw);
+  msg ("second reader left");
+}
+
+static void
+writer (void *aux UNUSED)
+{
+  rwlock_acquire_write (&rw);
+  msg ("writer acquired the lock");
+  rwlock_release_write (&rw);
+  msg ("writer done");
+}
+
+static void
+reader (void *aux UNUSED)
+{
+  rwlock_acquire_read (&rw);
+  msg ("reader acquired the lock");
+  rwlock_release_read (&rw);
+}
+
+void
+test_rwlock_donate (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rw);
+  sema_init (&second_done, 0);
+
+  rwlock_acquire_read (&rw);
+  thread_create ("second", PRI_DEFAULT + 1, second_reader, NULL);
+  thread_create ("writer", PRI_DEFAULT + 2, writer, NULL);
+  msg ("priority with a writer waiting: %d", thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 3, reader, NULL);
+  msg ("priority with a reader behind the writer: %d",
+       thread_get_priority ());
+
+  sema_up (&second_done);
+  msg ("first reader releasing");
+  rwlock_release_read (&rw);
+  msg ("priority after releasing: %d", thread_get_priority ());
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) second reader got in alongside the first
+(rwlock-donate) priority with a writer waiting: 33
+(rwlock-donate) priority with a reader behind the writer: 34
+(rwlock-donate) first reader releasing
+(rwlock-donate) writer acquired the lock
+(rwlock-donate) reader acquired the lock
+(rwlock-donate) writer done
+(rwlock-donate) second reader left
+(rwlock-donate) priority after releasing: 31
+(rwlock-donate) end
+EOF
+pass;
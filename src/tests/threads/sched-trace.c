@@ -0,0 +1,65 @@
+/* Checks that the scheduler tracer records a thread's wakeups,
+   switches and blocks in order, and that a woken thread's switch
+   carries the time it waited to run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/schedtrace.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define EVENT_CNT 64
+
+static struct semaphore sema;
+static struct sched_event events[EVENT_CNT];
+
+static void
+sleeper (void *aux UNUSED)
+{
+  sema_down (&sema);
+}
+
+static const char *
+describe (tid_t tid, tid_t main_tid)
+{
+  return tid == main_tid ? "main" : "another thread";
+}
+
+void
+test_sched_trace (void)
+{
+  tid_t main_tid = thread_tid ();
+  tid_t tid;
+  size_t cnt, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  schedtrace_enable ();
+  sema_init (&sema, 0);
+
+  /* The sleeper runs at once, blocks, and exits once woken. */
+  tid = thread_create ("sleeper", PRI_DEFAULT + 1, sleeper, NULL);
+  sema_up (&sema);
+
+  cnt = schedtrace_read (this_cpu (), events, EVENT_CNT);
+  for (i = 0; i < cnt; i++)
+    {
+      struct sched_event *e = &events[i];
+
+      if (e->type == SCHED_WAKEUP && e->tid == tid)
+        msg ("sleeper woken by %s", describe (e->prev, main_tid));
+      else if (e->type == SCHED_BLOCK && e->tid == tid)
+        msg ("sleeper blocked");
+      else if (e->type == SCHED_SWITCH && e->tid == tid)
+        msg ("switch from %s to sleeper%s", describe (e->prev, main_tid),
+             e->latency > 0 ? " after a wait" : "");
+      else if (e->type == SCHED_SWITCH && e->prev == tid)
+        msg ("switch from sleeper (%s) to %s",
+             e->prev_status == THREAD_DYING ? "dying" : "blocked",
+             describe (e->tid, main_tid));
+    }
+  pass ();
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-trace) begin
+(sched-trace) sleeper woken by main
+(sched-trace) switch from main to sleeper after a wait
+(sched-trace) sleeper blocked
+(sched-trace) switch from sleeper (blocked) to main
+(sched-trace) sleeper woken by main
+(sched-trace) switch from main to sleeper after a wait
+(sched-trace) switch from sleeper (dying) to main
+(sched-trace) PASS
+(sched-trace) end
+EOF
+pass;
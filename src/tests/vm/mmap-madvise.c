@@ -0,0 +1,37 @@
+/* Maps a file with MAP_POPULATE, applies every kind of madvise()
+   advice to it, and verifies that the data survives.  Also checks
+   that advice on unmapped memory is refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int advice[] = {MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED,
+                  MADV_DONTNEED, MADV_NORMAL};
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap_flags (handle, actual, MAP_POPULATE)) != MAP_FAILED,
+         "mmap \"sample.txt\" with MAP_POPULATE");
+
+  for (i = 0; i < sizeof advice / sizeof *advice; i++)
+    {
+      CHECK (madvise (actual, 4096, advice[i]) == 0, "madvise %d", advice[i]);
+      if (memcmp (actual, sample, strlen (sample)))
+        fail ("read of mmap'd file reported bad data");
+    }
+
+  CHECK (madvise (actual + 4096, 4096, MADV_WILLNEED) == -1,
+         "madvise past end of mapping");
+
+  munmap (map);
+  close (handle);
+}
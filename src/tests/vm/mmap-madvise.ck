@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-madvise) begin
+(mmap-madvise) open "sample.txt"
+(mmap-madvise) mmap "sample.txt" with MAP_POPULATE
+(mmap-madvise) madvise 2
+(mmap-madvise) madvise 1
+(mmap-madvise) madvise 3
+(mmap-madvise) madvise 4
+(mmap-madvise) madvise 0
+(mmap-madvise) madvise past end of mapping
+(mmap-madvise) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Writes to a file through a mapping and msync()s it, then reads
+   the data back using the read system call while the file is
+   still mapped.  Also checks that msync() leaves the file length
+   alone and refuses bad flags and unmapped memory. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  mapid_t map;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (ACTUAL, sample, strlen (sample));
+
+  CHECK (msync (ACTUAL, 4096, MS_ASYNC) == 0, "msync with MS_ASYNC");
+  CHECK (msync (ACTUAL, 4096, MS_SYNC) == 0, "msync with MS_SYNC");
+  CHECK (msync (ACTUAL, 4096, 0) == -1, "msync with bad flags");
+  CHECK (msync ((char *) ACTUAL + 4096, 4096, MS_SYNC) == -1,
+         "msync past end of mapping");
+
+  /* Read back via read() before unmapping. */
+  CHECK (filesize (handle) == (int) strlen (sample),
+         "file size unchanged");
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against written data");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-msync) begin
+(mmap-msync) create "sample.txt"
+(mmap-msync) open "sample.txt"
+(mmap-msync) mmap "sample.txt"
+(mmap-msync) msync with MS_ASYNC
+(mmap-msync) msync with MS_SYNC
+(mmap-msync) msync with bad flags
+(mmap-msync) msync past end of mapping
+(mmap-msync) file size unchanged
+(mmap-msync) compare read data against written data
+(mmap-msync) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Maps a file several read-around windows long with MAP_POPULATE
+   and checks that every page was read in by mmap() itself, so that
+   reading the mapping afterward takes no page faults. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 40
+
+static char buf[4096];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  struct vmstat before, after;
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  CHECK (create ("populate", PAGE_CNT * sizeof buf), "create \"populate\"");
+  CHECK ((handle = open ("populate")) > 1, "open \"populate\"");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      memset (buf, 'a' + i % 26, sizeof buf);
+      if (write (handle, buf, sizeof buf) != sizeof buf)
+        fail ("write \"populate\" failed");
+    }
+
+  CHECK ((map = mmap_flags (handle, actual, MAP_POPULATE)) != MAP_FAILED,
+         "mmap \"populate\" with MAP_POPULATE");
+  CHECK (vmstat (VMSTAT_SELF, &before, sizeof before) == sizeof before,
+         "read counters");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (actual[i * sizeof buf] != 'a' + (int) (i % 26)
+        || actual[i * sizeof buf + sizeof buf - 1] != 'a' + (int) (i % 26))
+      fail ("read of mmap'd file reported bad data in page %zu", i);
+  CHECK (vmstat (VMSTAT_SELF, &after, sizeof after) == sizeof after,
+         "read counters again");
+
+  if (after.counters[VMC_FAULT_FILE] != before.counters[VMC_FAULT_FILE])
+    fail ("%d faults on a populated mapping",
+          (int) (after.counters[VMC_FAULT_FILE]
+                 - before.counters[VMC_FAULT_FILE]));
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,64 @@
+/* Runs a child that dirties more memory than RAM and swap hold
+   together, so that the kernel must kill it, then checks that a
+   child that only needs part of the swap still runs to the end.
+   That requires the swap slots of the killed child to have been
+   released.  Repeats this a few times.
+
+   Derived from tests/userprog/no-vm/multi-oom.c. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+
+const char *test_name = "page-oom";
+
+#define ROUNDS 3
+#define HOG_SIZE (8 * 1024 * 1024)      /* More than RAM and swap. */
+#define FIT_SIZE (2 * 1024 * 1024)      /* More than RAM, not swap. */
+
+static char buf[HOG_SIZE];
+
+/* Fills the first SIZE bytes of BUF with data that neither
+   compresses nor reads as zeros, then turns it back into zeros
+   and checks them. */
+static void
+churn (size_t size)
+{
+  struct arc4 arc4;
+  size_t i;
+
+  arc4_init (&arc4, test_name, strlen (test_name));
+  arc4_crypt (&arc4, buf, size);
+
+  arc4_init (&arc4, test_name, strlen (test_name));
+  arc4_crypt (&arc4, buf, size);
+
+  for (i = 0; i < size; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int i;
+
+  if (argc > 1)
+    {
+      churn (!strcmp (argv[1], "hog") ? HOG_SIZE : FIT_SIZE);
+      return 0x42;
+    }
+
+  msg ("begin");
+  for (i = 0; i < ROUNDS; i++)
+    {
+      if (wait (exec ("page-oom hog")) != -1)
+        fail ("round %d: child using too much memory was not killed",
+              i + 1);
+      if (wait (exec ("page-oom fit")) != 0x42)
+        fail ("round %d: child failed after OOM kill", i + 1);
+    }
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,47 @@
+/* Writes to every page of a buffer in the BSS and checks that the
+   faults show up in the process's VM counters and in the fault
+   trace. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 16
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+  struct vm_trace_event events[8];
+  uint32_t page = (uint32_t) (buf + sizeof buf - 2 * 4096) & ~4095u;
+  int size;
+  size_t i;
+  bool found = false;
+
+  CHECK (vmstat (VMSTAT_SELF, &before, sizeof before) == sizeof before,
+         "read counters");
+  for (i = 0; i < sizeof buf; i += 4096)
+    buf[i] = 1;
+  CHECK (vmstat (VMSTAT_SELF, &after, sizeof after) == sizeof after,
+         "read counters again");
+
+  /* The first and last pages may be shared with data that was
+     already touched. */
+  if (after.counters[VMC_FAULT_BIN] - before.counters[VMC_FAULT_BIN]
+      < PAGE_CNT - 2)
+    fail ("page faults not counted");
+  if (after.counters[VMC_FAULT_CYCLES] <= before.counters[VMC_FAULT_CYCLES])
+    fail ("fault time not counted");
+
+  CHECK ((size = vmstat (VMSTAT_TRACE, events, sizeof events)) > 0,
+         "read fault trace");
+  for (i = 0; i < size / sizeof *events; i++)
+    if (events[i].vaddr == page && (events[i].flags & VM_TRACE_WRITE))
+      found = true;
+  if (!found)
+    fail ("write fault not traced");
+
+  CHECK (vmstat (-1, &before, sizeof before) == -1, "bad selector");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-vmstat) begin
+(page-vmstat) read counters
+(page-vmstat) read counters again
+(page-vmstat) read fault trace
+(page-vmstat) bad selector
+(page-vmstat) end
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Keeps writing to every page of a buffer in the BSS until the
+   working set sampler has seen them, then checks that the
+   process's resident set and working set estimate account for
+   the buffer. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 32
+
+/* Passes over the buffer before giving up on the sampler. */
+#define MAX_PASSES (1 << 20)
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  struct vmstat st;
+  int pass;
+  size_t i;
+
+  for (pass = 0; pass < MAX_PASSES; pass++)
+    {
+      for (i = 0; i < sizeof buf; i += 4096)
+        buf[i]++;
+      if (vmstat (VMSTAT_SELF, &st, sizeof st) != sizeof st)
+        fail ("read counters");
+      if (st.counters[VMC_RSS] >= PAGE_CNT && st.counters[VMC_WSS] > 0)
+        break;
+    }
+  if (pass == MAX_PASSES)
+    fail ("working set never sampled");
+  msg ("working set sampled");
+
+  if (st.counters[VMC_WSS] > st.counters[VMC_RSS])
+    fail ("working set %llu larger than resident set %llu",
+          st.counters[VMC_WSS], st.counters[VMC_RSS]);
+}
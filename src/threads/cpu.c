@@ -0,0 +1,28 @@
+#include "threads/cpu.h"
+
+/* The processor.
+
+   Pintos runs on the boot processor alone: the kernel counts on
+   disabling interrupts for mutual exclusion, which does not hold
+   off other processors.  Scheduler state that would be kept per
+   processor on a multiprocessor is gathered in a struct cpu all
+   the same, and this_cpu() is the one way to reach it. */
+
+static struct cpu boot_cpu;
+
+/* Sets up the boot processor.  Called by thread_init() before any
+   thread is queued. */
+void cpu_init(void)
+{
+    int i;
+
+    for (i = 0; i < READY_LEVELS; i++)
+        list_init(&boot_cpu.ready_lists[i]);
+}
+
+/* Returns the processor running the caller. */
+struct cpu *
+this_cpu(void)
+{
+    return &boot_cpu;
+}
@@ -0,0 +1,36 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Priority levels of a run queue. */
+#define READY_LEVELS (PRI_MAX - PRI_MIN + 1)
+
+/* The processor and its share of the scheduler: its idle thread,
+   its running thread and its run queue. */
+struct cpu
+{
+    struct thread *idle_thread;
+    struct thread *running; /* As of the last thread switch. */
+
+    /* Run queue of threads in THREAD_READY state.  There is one
+       FIFO list per priority, and a bitmap of the non-empty lists,
+       so that adding a thread, removing one and finding the highest
+       priority one all take constant time. */
+    struct list ready_lists[READY_LEVELS];
+    uint32_t ready_bitmap[(READY_LEVELS + 31) / 32];
+    size_t ready_cnt;
+
+    /* Scheduler trace, see threads/schedtrace.c.  Null while tracing
+       is off. */
+    struct sched_event *trace;
+    uint64_t trace_cnt; /* Events recorded so far. */
+};
+
+void cpu_init(void);
+struct cpu *this_cpu(void);
+
+#endif /* threads/cpu.h */
@@ -21,6 +21,7 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/schedtrace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -30,7 +31,11 @@
 #include "userprog/tss.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/share.h"
 #include "vm/swap.h"
+#include "vm/writeback.h"
+#include "vm/wss.h"
+#include "vm/zswap.h"
 #else
 #include "tests/threads/tests.h"
 #endif
@@ -44,6 +49,16 @@
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* -pse: Map memory with 4 MB pages where possible?  Cleared by
+   paging_init() if the CPU lacks support. */
+bool large_pages;
+
+/* -vmstat: Print each process's VM counters when it exits? */
+bool vmstat_dump;
+
+/* -schedtrace: Trace the scheduler? */
+bool sched_trace;
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -60,8 +75,12 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -sl: Maximum number of swap slots held by one process. */
+static size_t swap_slot_limit = SIZE_MAX;
+
 static void bss_init(void);
 static void paging_init(void);
+static bool enable_pse(void);
 
 static char **read_command_line(void);
 static char **parse_options(char **argv);
@@ -100,6 +119,8 @@ int main(void)
     palloc_init(user_page_limit);
     malloc_init();
     paging_init();
+    if (sched_trace)
+        schedtrace_enable();
 
     /* Segmentation. */
 #ifdef USERPROG
@@ -132,8 +153,20 @@ int main(void)
     /* Initialize LRU list */
     lru_list_init();
 
+    /* Initialize shared executable pages */
+    share_init();
+
     /* Initialize swap bitmap */
-    swap_bitmap_init();
+    swap_bitmap_init(swap_slot_limit);
+
+    /* Initialize compressed swap pool */
+    zswap_init();
+
+    /* Start background writeback of mapped files */
+    writeback_init();
+
+    /* Start working set sampling */
+    wss_init();
 
     printf("Boot complete.\n");
 
@@ -169,6 +202,9 @@ paging_init(void)
     size_t page;
     extern char _start, _end_kernel_text;
 
+    if (large_pages)
+        large_pages = enable_pse();
+
     pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
     pt = NULL;
     for (page = 0; page < init_ram_pages; page++)
@@ -179,6 +215,15 @@ paging_init(void)
         size_t pte_idx = pt_no(vaddr);
         bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+        /* Map whole 4 MB chunks of RAM without kernel text, which
+           must stay read-only, with a single large page each. */
+        if (large_pages && pte_idx == 0 && page + LARGE_PGCNT <= init_ram_pages && (vaddr + LARGE_PGSIZE <= &_start || &_end_kernel_text <= vaddr))
+        {
+            pd[pde_idx] = pde_create_large(vaddr, true, false);
+            page += LARGE_PGCNT - 1;
+            continue;
+        }
+
         if (pd[pde_idx] == 0)
         {
             pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
@@ -198,6 +243,34 @@ paging_init(void)
                  : "r"(vtop(init_page_dir)));
 }
 
+#define CPUID_PSE 0x00000008 /* CPUID.1:EDX, 4 MB pages supported. */
+#define CR4_PSE 0x00000010   /* CR4, enable 4 MB pages. */
+
+/* Turns on 4 MB page support (CR4.PSE) if the CPU has it, as
+   reported by CPUID.  Returns true if successful.  See [IA32-v3a]
+   3.7.3 "Mixing 4-KByte and 4-MByte Pages". */
+static bool
+enable_pse(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx, cr4;
+
+    asm volatile("cpuid"
+                 : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if ((edx & CPUID_PSE) == 0)
+    {
+        printf("CPU lacks 4 MB page support, ignoring -pse.\n");
+        return false;
+    }
+
+    asm volatile("movl %%cr4, %0"
+                 : "=r"(cr4));
+    cr4 |= CR4_PSE;
+    asm volatile("movl %0, %%cr4"
+                 :
+                 : "r"(cr4));
+    return true;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -260,12 +333,22 @@ parse_options(char **argv)
 #ifdef VM
         else if (!strcmp(name, "-swap"))
             swap_bdev_name = value;
+        else if (!strcmp(name, "-sl"))
+            swap_slot_limit = atoi(value);
 #endif
 #endif
         else if (!strcmp(name, "-rs"))
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-pse"))
+            large_pages = true;
+        else if (!strcmp(name, "-vmstat"))
+            vmstat_dump = true;
+        else if (!strcmp(name, "-lockprof"))
+            lock_profile = true;
+        else if (!strcmp(name, "-schedtrace"))
+            sched_trace = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -384,10 +467,15 @@ usage(void)
            "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
            "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+           "  -sl=COUNT          Limit each process to COUNT swap slots.\n"
 #endif
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -pse               Use 4 MB pages where possible.\n"
+           "  -vmstat            Print VM counters of each exiting process.\n"
+           "  -lockprof          Time lock waits and holds.\n"
+           "  -schedtrace        Trace the scheduler, print the trace at shutdown.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
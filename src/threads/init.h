@@ -9,4 +9,13 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* -pse: Map memory with 4 MB pages where possible? */
+extern bool large_pages;
+
+/* -vmstat: Print each process's VM counters when it exits? */
+extern bool vmstat_dump;
+
+/* -schedtrace: Trace the scheduler? */
+extern bool sched_trace;
+
 #endif /* threads/init.h */
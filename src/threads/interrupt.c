@@ -359,6 +359,7 @@ void intr_handler(struct intr_frame *frame)
 
         in_external_intr = true;
         yield_on_return = false;
+        timer_irq_enter();
     }
 
     /* Invoke the interrupt's handler. */
@@ -63,6 +63,7 @@ struct block
 /* Our set of descriptors. */
 static struct desc descs[10]; /* Descriptors. */
 static size_t desc_cnt;       /* Number of descriptors. */
+static struct lock_class desc_lock_class = LOCK_CLASS_INITIALIZER("malloc", LOCK_SPIN_SHORT);
 
 static struct arena *block_to_arena(struct block *);
 static struct block *arena_to_block(struct arena *, size_t idx);
@@ -79,7 +80,7 @@ void malloc_init(void)
         d->block_size = block_size;
         d->blocks_per_arena = (PGSIZE - sizeof(struct arena)) / block_size;
         list_init(&d->free_list);
-        lock_init(&d->lock);
+        lock_init_class(&d->lock, &desc_lock_class);
     }
 }
 
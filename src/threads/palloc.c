@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -35,6 +36,7 @@ struct pool
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
+static struct lock_class pool_lock_class = LOCK_CLASS_INITIALIZER("palloc", LOCK_SPIN_SHORT);
 
 static void init_pool(struct pool *, void *base, size_t page_cnt,
                       const char *name);
@@ -99,6 +101,43 @@ palloc_get_multiple(enum palloc_flags flags, size_t page_cnt)
     return pages;
 }
 
+/* Obtains LARGE_PGCNT contiguous free pages that start on a
+   LARGE_PGSIZE boundary, so that they can be mapped as one large
+   page.  FLAGS are interpreted as by palloc_get_multiple().
+   Unlike there, a null pointer is also returned when enough pages
+   are free but no aligned block of them is. */
+void *
+palloc_get_large(enum palloc_flags flags)
+{
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    uintptr_t base = (uintptr_t)pool->base;
+    size_t page_idx = (ROUND_UP(base, LARGE_PGSIZE) - base) / PGSIZE;
+    void *pages = NULL;
+
+    lock_acquire(&pool->lock);
+    for (; page_idx + LARGE_PGCNT <= bitmap_size(pool->used_map); page_idx += LARGE_PGCNT)
+        if (bitmap_none(pool->used_map, page_idx, LARGE_PGCNT))
+        {
+            bitmap_set_multiple(pool->used_map, page_idx, LARGE_PGCNT, true);
+            pages = pool->base + PGSIZE * page_idx;
+            break;
+        }
+    lock_release(&pool->lock);
+
+    if (pages != NULL)
+    {
+        if (flags & PAL_ZERO)
+            memset(pages, 0, LARGE_PGSIZE);
+    }
+    else
+    {
+        if (flags & PAL_ASSERT)
+            PANIC("palloc_get_large: out of pages");
+    }
+
+    return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -161,7 +200,7 @@ init_pool(struct pool *p, void *base, size_t page_cnt, const char *name)
     printf("%zu pages available in %s.\n", page_cnt, name);
 
     /* Initialize the pool. */
-    lock_init(&p->lock);
+    lock_init_class(&p->lock, &pool_lock_class);
     p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
     p->base = base + bm_pages * PGSIZE;
 }
@@ -28,6 +28,10 @@
 #define PDBITS 10                       /* Number of page dir bits. */
 #define PDMASK BITMASK(PDSHIFT, PDBITS) /* Page directory bits (22:31). */
 
+/* Large pages, mapped by a single PDE (see PTE_PS). */
+#define LARGE_PGSIZE PTSPAN       /* Bytes in a large page (4 MB). */
+#define LARGE_PGCNT (1 << PTBITS) /* Small pages in a large page. */
+
 /* Obtains page table index from a virtual address. */
 static inline unsigned pt_no(const void *va)
 {
@@ -68,6 +72,10 @@ static inline uintptr_t pd_no(const void *va)
 #define PTE_U 0x4            /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20           /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40           /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80          /* 1=4 MB page, 0=page table (PDEs only). */
+
+/* Address bits of a PDE that maps a large page. */
+#define PDE_ADDR_LARGE 0xffc00000
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create(uint32_t *pt)
@@ -84,6 +92,31 @@ static inline uint32_t *pde_get_pt(uint32_t pde)
     return ptov(pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the large page starting at PAGE,
+   which must be LARGE_PGSIZE aligned.  The page is readable, and
+   writable as well if WRITABLE is true.  It is usable by user
+   code if USER is true, otherwise only by the kernel.  Requires
+   the PSE bit in CR4. */
+static inline uint32_t pde_create_large(void *page, bool writable, bool user)
+{
+    ASSERT(((uintptr_t)page & (LARGE_PGSIZE - 1)) == 0);
+    return vtop(page) | PTE_PS | PTE_P | (writable ? PTE_W : 0) | (user ? PTE_U : 0);
+}
+
+/* Returns true if PDE maps a large page rather than pointing to a
+   page table. */
+static inline bool pde_is_large(uint32_t pde)
+{
+    return (pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+/* Returns a pointer to the large page that PDE maps. */
+static inline void *pde_get_large_page(uint32_t pde)
+{
+    ASSERT(pde_is_large(pde));
+    return ptov(pde & PDE_ADDR_LARGE);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
@@ -0,0 +1,191 @@
+#include "threads/schedtrace.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Scheduler tracer.
+
+   The scheduler records the switches, wakeups, blocks and time
+   slice expiries it sees into a ring kept in struct cpu, so that
+   recording needs no lock beyond having interrupts off.  The ring
+   keeps the last SCHED_TRACE_SIZE events; older ones are
+   overwritten.
+
+   Tracing is off until schedtrace_enable() allocates the ring,
+   which the -schedtrace kernel option does at boot.  The ring is
+   printed at shutdown, in the format utils/sched-timeline reads. */
+
+/* Pages per ring. */
+#define SCHED_TRACE_PAGES DIV_ROUND_UP(SCHED_TRACE_SIZE * sizeof(struct sched_event), PGSIZE)
+
+static const char *status_names[] = {"running", "ready", "blocked", "dying"};
+
+static struct sched_event *record(enum sched_event_type type, struct thread *t, uint64_t now);
+static uint32_t clamp(uint64_t cycles);
+static void print_thread(struct thread *t, void *aux);
+
+/* Starts tracing.  Does nothing if memory runs out. */
+void schedtrace_enable(void)
+{
+    struct cpu *cpu = this_cpu();
+    struct sched_event *trace;
+    enum intr_level old_level;
+
+    if (cpu->trace != NULL)
+        return;
+    trace = palloc_get_multiple(PAL_ZERO, SCHED_TRACE_PAGES);
+    if (trace == NULL)
+        return;
+
+    old_level = intr_disable();
+    cpu->trace_cnt = 0;
+    cpu->trace = trace;
+    intr_set_level(old_level);
+}
+
+/* Records a switch from PREV to NEXT, charging PREV for the time
+   since it was switched to and NEXT for the time since its wakeup.
+   Must be called with interrupts off. */
+void schedtrace_switch(struct thread *prev, struct thread *next)
+{
+    uint64_t now = timer_cycles();
+    struct sched_event *e = record(SCHED_SWITCH, next, now);
+
+    if (e != NULL)
+    {
+        e->prev = prev->tid;
+        e->prev_status = prev->status;
+        e->slice = prev->run_tsc != 0 ? clamp(now - prev->run_tsc) : 0;
+        e->latency = next->wake_tsc != 0 ? clamp(now - next->wake_tsc) : 0;
+    }
+    next->wake_tsc = 0;
+    next->run_tsc = now;
+}
+
+/* Records that T became ready.  Must be called with interrupts
+   off. */
+void schedtrace_wakeup(struct thread *t)
+{
+    uint64_t now = timer_cycles();
+    struct sched_event *e = record(SCHED_WAKEUP, t, now);
+
+    if (e != NULL)
+    {
+        e->prev = thread_current()->tid;
+        t->wake_tsc = now;
+    }
+}
+
+/* Records that T blocked.  Must be called with interrupts off. */
+void schedtrace_block(struct thread *t)
+{
+    record(SCHED_BLOCK, t, timer_cycles());
+}
+
+/* Records that T used up its time slice.  Must be called with
+   interrupts off. */
+void schedtrace_preempt(struct thread *t)
+{
+    record(SCHED_PREEMPT, t, timer_cycles());
+}
+
+/* Copies up to the last CNT events of CPU into EVENTS,
+   oldest first, and returns the number copied. */
+size_t schedtrace_read(struct cpu *cpu, struct sched_event *events, size_t cnt)
+{
+    enum intr_level old_level = intr_disable();
+    size_t have, i;
+
+    have = cpu->trace == NULL ? 0 : cpu->trace_cnt < SCHED_TRACE_SIZE ? cpu->trace_cnt : SCHED_TRACE_SIZE;
+    if (cnt > have)
+        cnt = have;
+    for (i = 0; i < cnt; i++)
+        events[i] = cpu->trace[(size_t)(cpu->trace_cnt - cnt + i) % SCHED_TRACE_SIZE];
+    intr_set_level(old_level);
+
+    return cnt;
+}
+
+/* Prints the names of the live threads and the traced events, one
+   per line.  Events are tagged with processor 0, the only one. */
+void schedtrace_print(void)
+{
+    static struct sched_event events[SCHED_TRACE_SIZE];
+    struct cpu *cpu = this_cpu();
+    enum intr_level old_level;
+    size_t i, cnt;
+
+    if (cpu->trace == NULL)
+        return;
+
+    old_level = intr_disable();
+    thread_foreach(print_thread, NULL);
+    intr_set_level(old_level);
+
+    cnt = schedtrace_read(cpu, events, SCHED_TRACE_SIZE);
+    printf("Sched trace: cpu 0, idle thread %d, %llu events, last %zu follow\n",
+           cpu->idle_thread != NULL ? cpu->idle_thread->tid : -1, cpu->trace_cnt, cnt);
+    for (i = 0; i < cnt; i++)
+    {
+        struct sched_event *e = &events[i];
+        printf("sched 0 %llu ", e->tsc);
+        switch (e->type)
+        {
+        case SCHED_SWITCH:
+            printf("switch %d %d %s %u %u %u\n", e->tid, e->prev,
+                   e->prev_status < 4 ? status_names[e->prev_status] : "?",
+                   e->priority, e->slice, e->latency);
+            break;
+        case SCHED_WAKEUP:
+            printf("wakeup %d %d %u\n", e->tid, e->prev, e->priority);
+            break;
+        case SCHED_BLOCK:
+            printf("block %d\n", e->tid);
+            break;
+        case SCHED_PREEMPT:
+            printf("preempt %d\n", e->tid);
+            break;
+        }
+    }
+}
+
+/* Adds an event of TYPE about T at time NOW to the ring and returns it, or returns a null pointer if
+   tracing is off. */
+static struct sched_event *
+record(enum sched_event_type type, struct thread *t, uint64_t now)
+{
+    struct cpu *cpu = this_cpu();
+    struct sched_event *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cpu->trace == NULL)
+        return NULL;
+
+    e = &cpu->trace[(size_t)cpu->trace_cnt++ % SCHED_TRACE_SIZE];
+    e->tsc = now;
+    e->type = type;
+    e->tid = t->tid;
+    e->priority = t->priority;
+    e->prev = 0;
+    e->prev_status = 0;
+    e->slice = e->latency = 0;
+    return e;
+}
+
+static uint32_t
+clamp(uint64_t cycles)
+{
+    return cycles < UINT32_MAX ? cycles : UINT32_MAX;
+}
+
+static void
+print_thread(struct thread *t, void *aux UNUSED)
+{
+    printf("sched-thread %d %s\n", t->tid, t->name);
+}
@@ -0,0 +1,45 @@
+#ifndef THREADS_SCHEDTRACE_H
+#define THREADS_SCHEDTRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+struct cpu;
+
+/* Events kept in the ring. */
+#define SCHED_TRACE_SIZE 512
+
+/* Kinds of scheduler events. */
+enum sched_event_type
+{
+    SCHED_SWITCH,  /* PREV gave the processor to TID. */
+    SCHED_WAKEUP,  /* TID became ready, woken by PREV. */
+    SCHED_BLOCK,   /* TID blocked. */
+    SCHED_PREEMPT  /* TID used up its time slice. */
+};
+
+/* One scheduler event, as recorded by the tracer.  Times are in
+   CPU cycles, clamped to UINT32_MAX. */
+struct sched_event
+{
+    uint64_t tsc;        /* Time stamp counter. */
+    uint32_t slice;      /* SWITCH: how long PREV ran. */
+    uint32_t latency;    /* SWITCH: how long TID waited since its
+                            wakeup, 0 if it was not woken. */
+    tid_t tid;
+    tid_t prev;
+    uint8_t type;        /* enum sched_event_type. */
+    uint8_t prev_status; /* SWITCH: enum thread_status left to PREV. */
+    uint8_t priority;    /* TID's priority. */
+};
+
+void schedtrace_enable(void);
+void schedtrace_switch(struct thread *prev, struct thread *next);
+void schedtrace_wakeup(struct thread *t);
+void schedtrace_block(struct thread *t);
+void schedtrace_preempt(struct thread *t);
+size_t schedtrace_read(struct cpu *, struct sched_event *events, size_t cnt);
+void schedtrace_print(void);
+
+#endif /* threads/schedtrace.h */
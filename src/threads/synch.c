@@ -29,10 +29,27 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
 static void donate(struct lock *lock, int priority);
+static void donate_readers(struct rwlock *rw, int priority);
+static bool lock_spin(struct lock *lock, int *yields);
+static void profile_wait(struct lock_class *class, uint64_t cycles);
+static bool more_wait(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
+
+/* If true, lock classes keep wait and hold times. */
+bool lock_profile;
+
+/* Lock classes that have had a lock initialized. */
+static struct list lock_classes = LIST_INITIALIZER(lock_classes);
+
+/* Class of locks initialized with lock_init(). */
+static struct lock_class default_class = LOCK_CLASS_INITIALIZER("other", 0);
+
+/* Class of the locks in struct rw_hold. */
+static struct lock_class read_hold_class = LOCK_CLASS_INITIALIZER("rwlock read", 0);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -180,12 +197,31 @@ sema_test_helper(void *sema_)
    instead of a lock. */
 void lock_init(struct lock *lock)
 {
+    lock_init_class(lock, &default_class);
+}
+
+/* Initializes LOCK as a member of CLASS.  See lock_init(). */
+void lock_init_class(struct lock *lock, struct lock_class *class)
+{
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
+    ASSERT(class != NULL);
 
     lock->holder = NULL;
     sema_init(&lock->semaphore, 1);
+    lock->class = class;
     lock->donated_priority = -1;
     lock->is_donated = false;
+    lock->acquired_at = 0;
+
+    old_level = intr_disable();
+    if (!class->registered)
+    {
+        class->registered = true;
+        list_push_back(&lock_classes, &class->elem);
+    }
+    intr_set_level(old_level);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -203,25 +239,108 @@ void lock_acquire(struct lock *lock)
     ASSERT(!lock_held_by_current_thread(lock));
 
     struct thread *t = thread_current();
+    struct lock_class *class = lock->class;
+    bool contended = false, slept = false;
+    int yields = 0;
+    uint64_t start = 0;
+    enum intr_level old_level;
 
     if (!sema_try_down(&lock->semaphore))
     {
-        // Compare priority with lock owner.
-        int priority = t->priority;
-
-        if (priority > lock->holder->priority)
+        contended = true;
+        if (lock_profile)
+            start = timer_cycles();
+        if (!lock_spin(lock, &yields))
         {
-            donate(lock, priority);
-            list_sort(&t->lock_list, less_donated_priority, NULL);
-        }
+            // Compare priority with lock owner.
+            int priority = t->priority;
 
-        t->blocker = lock;
-        sema_down(&lock->semaphore);
+            old_level = intr_disable();
+            if (lock->holder != NULL && priority > lock->holder->priority)
+            {
+                donate(lock, priority);
+                list_sort(&t->lock_list, less_donated_priority, NULL);
+            }
+            intr_set_level(old_level);
+
+            t->blocker = lock;
+            sema_down(&lock->semaphore);
+            slept = true;
+        }
     }
 
     list_insert_ordered(&t->lock_list, &lock->elem, less_donated_priority, NULL);
     lock->holder = t;
     t->blocker = NULL;
+    lock->acquired_at = lock_profile ? timer_cycles() : 0;
+
+    old_level = intr_disable();
+    class->acquire_cnt++;
+    if (contended)
+    {
+        class->contend_cnt++;
+        class->yield_cnt += yields;
+        if (slept)
+            class->sleep_cnt++;
+        else
+            class->spun_cnt++;
+        if (start != 0)
+            profile_wait(class, lock->acquired_at - start);
+    }
+    intr_set_level(old_level);
+}
+
+/* Adds a wait of CYCLES to CLASS's profile.  Must be called with
+   interrupts off. */
+static void
+profile_wait(struct lock_class *class, uint64_t cycles)
+{
+    int bucket = 0;
+
+    while (bucket < LOCK_HIST_CNT - 1 && cycles >= (1024ULL << 3 * bucket))
+        bucket++;
+    class->wait_hist[bucket]++;
+    class->wait_cycles += cycles;
+    if (cycles > class->max_wait)
+        class->max_wait = cycles;
+}
+
+/* Waits for LOCK, held by another thread, without sleeping, as
+   described for struct lock_class.  On a single processor only
+   yielding to a holder of equal priority can help.  Adds the number of times it
+   yielded to *YIELDS.  Returns true if it got LOCK, false if the
+   caller must sleep for it. */
+static bool
+lock_spin(struct lock *lock, int *yields)
+{
+    int round;
+
+    for (round = 0; round < lock->class->spin_limit; round++)
+    {
+        enum intr_level old_level = intr_disable();
+        struct thread *holder = lock->holder;
+        bool running = holder != NULL && holder->status == THREAD_RUNNING;
+        bool ready = holder != NULL && holder->status == THREAD_READY && holder->priority >= thread_get_priority();
+        intr_set_level(old_level);
+
+        /* A null holder is between releasing and handing over.  A
+           sleeping or lower priority holder won't let go before we
+           sleep and donate it our priority. */
+        if (holder != NULL && !running && !ready)
+            return false;
+
+        if (ready)
+        {
+            thread_yield();
+            (*yields)++;
+        }
+        else
+            asm volatile("pause");
+
+        if (sema_try_down(&lock->semaphore))
+            return true;
+    }
+    return false;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -239,7 +358,13 @@ bool lock_try_acquire(struct lock *lock)
 
     success = sema_try_down(&lock->semaphore);
     if (success)
+    {
+        enum intr_level old_level = intr_disable();
         lock->holder = thread_current();
+        lock->acquired_at = lock_profile ? timer_cycles() : 0;
+        lock->class->acquire_cnt++;
+        intr_set_level(old_level);
+    }
     return success;
 }
 
@@ -253,6 +378,18 @@ void lock_release(struct lock *lock)
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
+    if (lock->acquired_at != 0)
+    {
+        struct lock_class *class = lock->class;
+        uint64_t held = timer_cycles() - lock->acquired_at;
+        enum intr_level old_level = intr_disable();
+        class->hold_cycles += held;
+        if (held > class->max_hold)
+            class->max_hold = held;
+        intr_set_level(old_level);
+        lock->acquired_at = 0;
+    }
+
     struct thread *t_holder = lock->holder;
     lock->holder = NULL;
     list_remove(&lock->elem);
@@ -295,6 +432,173 @@ bool lock_held_by_current_thread(const struct lock *lock)
     return lock->holder == thread_current();
 }
 
+/* Prints the contention statistics of each lock class that has
+   been acquired, and its profile if lock_profile is true.  Classes
+   that made threads wait longest come first. */
+void lock_print_stats(void)
+{
+    static const char *bucket_names[LOCK_HIST_CNT] = {"<1K", "<8K", "<64K", "<512K",
+                                                      "<4M", "<32M", "<256M", ">=256M"};
+    struct list_elem *e;
+    enum intr_level old_level;
+    int i;
+
+    old_level = intr_disable();
+    list_sort(&lock_classes, more_wait, NULL);
+    intr_set_level(old_level);
+
+    for (e = list_begin(&lock_classes); e != list_end(&lock_classes); e = list_next(e))
+    {
+        struct lock_class *class = list_entry(e, struct lock_class, elem);
+        if (class->acquire_cnt == 0)
+            continue;
+        printf("Lock %s: %llu acquired, %llu contended, %llu without sleeping (%llu yields), %llu slept\n",
+               class->name, class->acquire_cnt, class->contend_cnt, class->spun_cnt,
+               class->yield_cnt, class->sleep_cnt);
+        if (!lock_profile)
+            continue;
+
+        printf("  waited %llu cycles (max %llu), held %llu cycles (max %llu)\n",
+               class->wait_cycles, class->max_wait, class->hold_cycles, class->max_hold);
+        printf("  waits:");
+        for (i = 0; i < LOCK_HIST_CNT; i++)
+            printf(" %s %llu", bucket_names[i], class->wait_hist[i]);
+        printf("\n");
+    }
+}
+
+/* Orders lock classes by total wait time, longest first. */
+static bool
+more_wait(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
+{
+    const struct lock_class *a = list_entry(a_, struct lock_class, elem);
+    const struct lock_class *b = list_entry(b_, struct lock_class, elem);
+
+    return a->wait_cycles > b->wait_cycles;
+}
+
+/* Initializes RW, unheld. */
+void rwlock_init(struct rwlock *rw)
+{
+    rwlock_init_class(rw, &default_class);
+}
+
+/* Initializes RW, unheld, with its writer side in lock class
+   CLASS.  Read holds are counted in a class of their own. */
+void rwlock_init_class(struct rwlock *rw, struct lock_class *class)
+{
+    ASSERT(rw != NULL);
+
+    lock_init_class(&rw->lock, class);
+    list_init(&rw->readers);
+    sema_init(&rw->drained, 0);
+    rw->writer_waiting = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  The current thread must not hold RW already.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw)
+{
+    struct thread *t = thread_current();
+    struct rw_hold *hold = NULL;
+    enum intr_level old_level;
+    int i;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    for (i = 0; i < RW_HOLD_MAX; i++)
+    {
+        ASSERT(t->rw_holds[i].rwlock != rw);
+        if (hold == NULL && t->rw_holds[i].rwlock == NULL)
+            hold = &t->rw_holds[i];
+    }
+    ASSERT(hold != NULL);
+
+    /* Get past the writer, if any. */
+    lock_acquire(&rw->lock);
+
+    hold->rwlock = rw;
+    lock_init_class(&hold->lock, &read_hold_class);
+    lock_acquire(&hold->lock);
+
+    old_level = intr_disable();
+    list_push_back(&rw->readers, &hold->elem);
+    intr_set_level(old_level);
+
+    lock_release(&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void rwlock_release_read(struct rwlock *rw)
+{
+    struct thread *t = thread_current();
+    struct rw_hold *hold = NULL;
+    enum intr_level old_level;
+    bool wake_writer;
+    int i;
+
+    ASSERT(rw != NULL);
+
+    for (i = 0; i < RW_HOLD_MAX; i++)
+        if (t->rw_holds[i].rwlock == rw)
+            hold = &t->rw_holds[i];
+    ASSERT(hold != NULL);
+
+    old_level = intr_disable();
+    list_remove(&hold->elem);
+    wake_writer = rw->writer_waiting && list_empty(&rw->readers);
+    if (wake_writer)
+        rw->writer_waiting = false;
+    intr_set_level(old_level);
+
+    /* Wake the writer before giving back its donation, so that it
+       runs before anything of priority in between. */
+    if (wake_writer)
+        sema_up(&rw->drained);
+    lock_release(&hold->lock);
+    hold->rwlock = NULL;
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not hold RW already.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rw)
+{
+    struct thread *t = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    /* Holding the lock keeps new readers out. */
+    lock_acquire(&rw->lock);
+
+    old_level = intr_disable();
+    if (!list_empty(&rw->readers))
+    {
+        rw->writer_waiting = true;
+        donate_readers(rw, t->priority);
+        t->rw_blocker = rw;
+        sema_down(&rw->drained);
+        t->rw_blocker = NULL;
+    }
+    intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void rwlock_release_write(struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+
+    lock_release(&rw->lock);
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem
 {
@@ -392,6 +696,7 @@ static void donate(struct lock *lock, int priority)
     lock->holder->priority = priority;
     lock->donated_priority = priority;
     lock->is_donated = true;
+    thread_requeue(lock->holder);
 
     // Nested donation is needed.
     if (lock->holder->blocker != NULL)
@@ -399,6 +704,29 @@ static void donate(struct lock *lock, int priority)
         if (lock->holder->status == THREAD_BLOCKED)
             donate(lock->holder->blocker, priority);
     }
+    else if (lock->holder->rw_blocker != NULL)
+        donate_readers(lock->holder->rw_blocker, priority);
+}
+
+/* Donates PRIORITY to each reader of RW below it.  Interrupts must
+   be off. */
+static void donate_readers(struct rwlock *rw, int priority)
+{
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (e = list_begin(&rw->readers); e != list_end(&rw->readers); e = list_next(e))
+    {
+        struct rw_hold *hold = list_entry(e, struct rw_hold, elem);
+        struct thread *reader = hold->lock.holder;
+
+        if (priority > reader->priority)
+        {
+            donate(&hold->lock, priority);
+            list_sort(&reader->lock_list, less_donated_priority, NULL);
+        }
+    }
 }
 
 bool less_donated_priority(struct list_elem *a, struct list_elem *b, void *aux UNUSED)
@@ -422,4 +750,4 @@ bool less_cond_priority(struct list_elem *a, struct list_elem *b, void *aux UNUS
     if (t_a->priority <= t_b->priority)
         return true;
     return false;
-}
\ No newline at end of file
+}
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore
@@ -18,22 +19,113 @@ bool sema_try_down(struct semaphore *);
 void sema_up(struct semaphore *);
 void sema_self_test(void);
 
+/* Buckets in a lock class's histogram of wait times.  Bucket I
+   counts waits shorter than 1024 << 3 * I cycles, the last one
+   the rest. */
+#define LOCK_HIST_CNT 8
+
+/* A class of locks, such as all the malloc() descriptor locks,
+   that share contention statistics.
+
+   Locks of a class with a nonzero SPIN_LIMIT are adaptive: when
+   one is held, lock_acquire() first waits up to SPIN_LIMIT rounds
+   without sleeping, spinning while the holder runs on another
+   processor and yielding while it is ready to run, in the hope
+   that a short critical section ends first.  It sleeps right away
+   if the holder is itself asleep.  Suits locks held for a few
+   instructions at a time. */
+struct lock_class
+{
+    const char *name;
+    int spin_limit;        /* Rounds before sleeping, 0 for none. */
+    bool registered;       /* In the list of classes yet? */
+    struct list_elem elem; /* List of classes. */
+
+    /* Statistics. */
+    unsigned long long acquire_cnt; /* Acquisitions. */
+    unsigned long long contend_cnt; /* Found the lock held. */
+    unsigned long long spun_cnt;    /* Got it held without sleeping. */
+    unsigned long long yield_cnt;   /* Yields while waiting. */
+    unsigned long long sleep_cnt;   /* Slept waiting. */
+
+    /* Profile, kept only while lock_profile is true.  Times are in
+       CPU cycles; a wait is counted from finding the lock held to
+       getting it. */
+    unsigned long long wait_cycles; /* Total time waited. */
+    unsigned long long max_wait;    /* Longest wait. */
+    unsigned long long hold_cycles; /* Total time held. */
+    unsigned long long max_hold;    /* Longest hold. */
+    unsigned long long wait_hist[LOCK_HIST_CNT]; /* Waits by length. */
+};
+
+/* Spin limit for locks held a few instructions at a time. */
+#define LOCK_SPIN_SHORT 4
+
+/* Initializer for a static struct lock_class. */
+#define LOCK_CLASS_INITIALIZER(NAME, SPIN_LIMIT) \
+    {                                            \
+        .name = (NAME), .spin_limit = (SPIN_LIMIT) \
+    }
+
 /* Lock. */
 struct lock
 {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct lock_class *class;   /* Class, for statistics and spinning. */
 
     struct list_elem elem;
     int donated_priority;
     bool is_donated;
+
+    uint64_t acquired_at; /* Cycle count when acquired, if profiled. */
 };
 
 void lock_init(struct lock *);
+void lock_init_class(struct lock *, struct lock_class *);
 void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
+void lock_print_stats(void);
+
+/* If true, lock classes keep wait and hold times. */
+extern bool lock_profile;
+
+/* Readers-writer lock.  Any number of readers or a single writer
+   may hold it at a time.  A writer that has to wait for readers
+   keeps new readers out, so writers don't starve.
+
+   Priority donation works as for locks.  A thread waiting for the
+   lock donates its priority to the writer holding it, or to every
+   reader if readers hold it, and on down the chain from there. */
+struct rwlock
+{
+    struct lock lock;         /* Held by the writer, briefly by readers. */
+    struct list readers;      /* rw_holds of the readers. */
+    struct semaphore drained; /* Upped by the last reader to leave... */
+    bool writer_waiting;      /* ...if a writer waits for that. */
+};
+
+/* Number of rwlocks a thread may hold for reading at once. */
+#define RW_HOLD_MAX 4
+
+/* A thread's hold on a rwlock as a reader.  LOCK stands in for the
+   rwlock in the thread's lock_list, so that priority donated to the
+   reader is given back on release as for any other lock. */
+struct rw_hold
+{
+    struct rwlock *rwlock; /* Null if this hold is free. */
+    struct lock lock;
+    struct list_elem elem; /* Element in RWLOCK's readers. */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_init_class(struct rwlock *, struct lock_class *);
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
 
 /* Condition variable. */
 struct condition
@@ -4,14 +4,17 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/schedtrace.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "filesys/file.h"
@@ -23,24 +26,20 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* The run queues of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running, are
+   kept in struct cpu. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-static struct list sleep_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
-
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
+static struct lock_class tid_lock_class = LOCK_CLASS_INITIALIZER("tid", LOCK_SPIN_SHORT);
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
@@ -64,11 +63,30 @@ static unsigned thread_ticks; /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
-/* MLFQS scheduling */
+/* MLFQS scheduling.  Only threads whose recent_cpu changed are
+   looked at: those charged a tick since the last priority update,
+   and once a second the running and ready threads.  Blocked
+   threads catch up on the decays they missed when they wake. */
+#define PRIORITY_INTERVAL 4 /* Ticks between priority updates. */
+#define DECAY_HISTORY 64    /* Seconds of decay a thread can catch up. */
 static fixed_point load_avg;
+static struct thread *charged[PRIORITY_INTERVAL]; /* Charged a tick. */
+static int charged_cnt;
+static int64_t decay_epoch;                       /* Seconds decayed. */
+static fixed_point decay_coeff[DECAY_HISTORY];    /* By epoch. */
+static uint64_t mlfqs_cycles;                     /* Spent on the above. */
 
 static void kernel_thread(thread_func *, void *aux);
 
+static void ready_push(struct thread *);
+static void ready_remove(struct thread *);
+static struct thread *ready_pop(struct cpu *);
+static int ready_max_priority(struct cpu *);
+
+static int mlfqs_priority(struct thread *);
+static void catch_up_recent_cpu(struct thread *);
+static void decay_recent_cpu(void);
+
 static void idle(void *aux UNUSED);
 static struct thread *running_thread(void);
 static struct thread *next_thread_to_run(void);
@@ -84,7 +102,7 @@ static tid_t allocate_tid(void);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues and the tid lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -96,12 +114,10 @@ void thread_init(void)
 {
     ASSERT(intr_get_level() == INTR_OFF);
 
-    lock_init(&tid_lock);
-    list_init(&ready_list);
+    lock_init_class(&tid_lock, &tid_lock_class);
+    cpu_init();
     list_init(&all_list);
 
-    list_init(&sleep_list);
-
     load_avg = 0;
 
     /* Set up a thread structure for the running thread. */
@@ -109,6 +125,7 @@ void thread_init(void)
     init_thread(initial_thread, "main", PRI_DEFAULT, NULL);
     initial_thread->status = THREAD_RUNNING;
     initial_thread->tid = allocate_tid();
+    this_cpu()->running = initial_thread;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -123,7 +140,7 @@ void thread_start(void)
     /* Start preemptive thread scheduling. */
     intr_enable();
 
-    /* Wait for the idle thread to initialize idle_thread. */
+    /* Wait for the idle thread to set itself up. */
     sema_down(&idle_started);
 }
 
@@ -134,7 +151,7 @@ void thread_tick(void)
     struct thread *t = thread_current();
 
     /* Update statistics. */
-    if (t == idle_thread)
+    if (t == this_cpu()->idle_thread)
         idle_ticks++;
 #ifdef USERPROG
     else if (t->pagedir != NULL)
@@ -145,7 +162,10 @@ void thread_tick(void)
 
     /* Enforce preemption. */
     if (++thread_ticks >= TIME_SLICE)
+    {
+        schedtrace_preempt(t);
         intr_yield_on_return();
+    }
 }
 
 /* Prints thread statistics. */
@@ -153,6 +173,47 @@ void thread_print_stats(void)
 {
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
            idle_ticks, kernel_ticks, user_ticks);
+    if (thread_mlfqs && timer_ticks() > 0)
+        printf("Thread: MLFQS bookkeeping took %llu cycles per tick\n",
+               mlfqs_cycles / timer_ticks());
+}
+
+/* Does the MLFQS bookkeeping for timer tick TICKS.  Runs in an
+   external interrupt context. */
+void thread_mlfqs_tick(int64_t ticks)
+{
+    uint64_t start = timer_cycles();
+    struct thread *cur = thread_current();
+    int i;
+
+    if (cur != this_cpu()->idle_thread)
+    {
+        cur->recent_cpu = x_add_n(cur->recent_cpu, 1);
+        if (!cur->cpu_charged)
+        {
+            ASSERT(charged_cnt < PRIORITY_INTERVAL);
+            cur->cpu_charged = true;
+            charged[charged_cnt++] = cur;
+        }
+    }
+
+    if (ticks % TIMER_FREQ == 0)
+    {
+        update_load_avg();
+        decay_recent_cpu();
+    }
+
+    if (ticks % PRIORITY_INTERVAL == 0)
+    {
+        for (i = 0; i < charged_cnt; i++)
+        {
+            charged[i]->cpu_charged = false;
+            realloc_priority(charged[i], NULL);
+        }
+        charged_cnt = 0;
+    }
+
+    mlfqs_cycles += timer_cycles() - start;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -244,6 +305,7 @@ void thread_block(void)
     ASSERT(intr_get_level() == INTR_OFF);
 
     thread_current()->status = THREAD_BLOCKED;
+    schedtrace_block(thread_current());
     schedule();
 }
 
@@ -253,6 +315,7 @@ void thread_block_without_intr(void)
 
     old_level = intr_disable();
     thread_current()->status = THREAD_BLOCKED;
+    schedtrace_block(thread_current());
     schedule();
     intr_set_level(old_level);
 }
@@ -273,8 +336,14 @@ void thread_unblock(struct thread *t)
 
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
-    list_insert_ordered(&ready_list, &t->elem, less_priority, NULL);
+    if (thread_mlfqs)
+    {
+        catch_up_recent_cpu(t);
+        t->priority = mlfqs_priority(t);
+    }
+    ready_push(t);
     t->status = THREAD_READY;
+    schedtrace_wakeup(t);
     intr_set_level(old_level);
 }
 
@@ -338,6 +407,15 @@ void thread_exit(int status)
     list_remove(&cur->allelem);
     cur->status = THREAD_DYING;
 
+    /* Don't leave a dangling pointer for thread_mlfqs_tick(). */
+    if (cur->cpu_charged)
+    {
+        int i;
+        for (i = 0; charged[i] != cur; i++)
+            continue;
+        charged[i] = charged[--charged_cnt];
+    }
+
     schedule();
     NOT_REACHED();
 }
@@ -352,8 +430,8 @@ void thread_yield(void)
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    if (cur != idle_thread)
-        list_insert_ordered(&ready_list, &cur->elem, less_priority, NULL);
+    if (cur != this_cpu()->idle_thread)
+        ready_push(cur);
     cur->status = THREAD_READY;
     schedule();
     intr_set_level(old_level);
@@ -361,17 +439,24 @@ void thread_yield(void)
 
 void thread_priority_yield(void)
 {
-    if (list_empty(&ready_list))
-        return;
-
-    struct list_elem *e = list_back(&ready_list);
-    struct thread *t = list_entry(e, struct thread, elem);
-
     // Check if current thread is no longer highest priority.
-    if (t->priority >= thread_get_priority())
+    if (ready_max_priority(this_cpu()) >= thread_get_priority())
         thread_yield();
 }
 
+/* Moves T to the run queue of its current priority if it is ready
+   and its priority changed since it was queued. */
+void thread_requeue(struct thread *t)
+{
+    enum intr_level old_level = intr_disable();
+    if (t->status == THREAD_READY && t->ready_priority != t->priority)
+    {
+        ready_remove(t);
+        ready_push(t);
+    }
+    intr_set_level(old_level);
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void thread_foreach(thread_action_func *func, void *aux)
@@ -407,8 +492,19 @@ int thread_get_priority(void)
 
 void realloc_priority(struct thread *t, void *aux UNUSED)
 {
-    int new_priority = PRI_MAX - fixed2int(x_div_n(t->recent_cpu, 4)) - (t->nice * 2);
-    t->priority = new_priority;
+    t->priority = mlfqs_priority(t);
+    thread_requeue(t);
+}
+
+/* Returns T's priority under the MLFQS. */
+static int mlfqs_priority(struct thread *t)
+{
+    int priority = PRI_MAX - fixed2int(x_div_n(t->recent_cpu, 4)) - (t->nice * 2);
+    if (priority < PRI_MIN)
+        return PRI_MIN;
+    if (priority > PRI_MAX)
+        return PRI_MAX;
+    return priority;
 }
 
 /* Sets the current thread's nice value to NICE. */
@@ -436,7 +532,8 @@ int thread_get_load_avg(void)
 
 void update_load_avg(void)
 {
-    int ready_threads = thread_current() == idle_thread ? list_size(&ready_list) : list_size(&ready_list) + 1;
+    struct cpu *cpu = this_cpu();
+    int ready_threads = cpu->running == cpu->idle_thread ? cpu->ready_cnt : cpu->ready_cnt + 1;
     fixed_point left = x_mul_y(x_div_n(int2fixed(59), 60), load_avg);
     fixed_point right = x_mul_n(x_div_n(int2fixed(1), 60), ready_threads);
 
@@ -449,19 +546,59 @@ int thread_get_recent_cpu(void)
     return fixed2int(x_mul_n(thread_current()->recent_cpu, 100));
 }
 
-void update_recent_cpu(void)
+/* Starts a new second of recent_cpu decay.  Brings the running
+   threads and every ready thread up to date and requeues the ready
+   ones by their new priorities.  Blocked threads are left to
+   catch_up_recent_cpu(), since their priority does not matter until
+   they wake. */
+static void
+decay_recent_cpu(void)
 {
-    if (thread_current() != idle_thread)
-        thread_current()->recent_cpu = x_add_n(thread_current()->recent_cpu, 1);
+    struct cpu *cpu = this_cpu();
+    struct list ready;
+    int level;
+
+    fixed_point tmp = x_mul_n(load_avg, 2);
+    decay_epoch++;
+    decay_coeff[decay_epoch % DECAY_HISTORY] = x_div_y(tmp, x_add_n(tmp, 1));
+
+    list_init(&ready);
+    for (level = READY_LEVELS - 1; level >= 0; level--)
+        while (!list_empty(&cpu->ready_lists[level]))
+            list_push_back(&ready, list_pop_front(&cpu->ready_lists[level]));
+    memset(cpu->ready_bitmap, 0, sizeof cpu->ready_bitmap);
+    cpu->ready_cnt = 0;
+
+    while (!list_empty(&ready))
+    {
+        struct thread *t = list_entry(list_pop_front(&ready), struct thread, elem);
+        catch_up_recent_cpu(t);
+        t->priority = mlfqs_priority(t);
+        ready_push(t);
+    }
+
+    if (cpu->running != cpu->idle_thread)
+    {
+        catch_up_recent_cpu(cpu->running);
+        cpu->running->priority = mlfqs_priority(cpu->running);
+    }
 }
 
-void realloc_recent_cpu(struct thread *t, void *aux UNUSED)
+/* Applies the recent_cpu decays T missed since it was last brought
+   up to date.  A thread blocked for more than DECAY_HISTORY seconds
+   only gets the last DECAY_HISTORY of them, by which time its
+   older CPU usage has mostly decayed away. */
+static void
+catch_up_recent_cpu(struct thread *t)
 {
-    fixed_point tmp = x_mul_n(load_avg, 2);
-    fixed_point left = x_mul_y(x_div_y(tmp, x_add_n(tmp, 1)), t->recent_cpu);
-    int right = t->nice;
+    if (decay_epoch - t->cpu_epoch > DECAY_HISTORY)
+        t->cpu_epoch = decay_epoch - DECAY_HISTORY;
 
-    t->recent_cpu = x_add_n(left, right);
+    while (t->cpu_epoch < decay_epoch)
+    {
+        t->cpu_epoch++;
+        t->recent_cpu = x_add_n(x_mul_y(decay_coeff[t->cpu_epoch % DECAY_HISTORY], t->recent_cpu), t->nice);
+    }
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -477,7 +614,7 @@ static void
 idle(void *idle_started_ UNUSED)
 {
     struct semaphore *idle_started = idle_started_;
-    idle_thread = thread_current();
+    this_cpu()->idle_thread = thread_current();
     sema_up(idle_started);
 
     for (;;)
@@ -486,6 +623,9 @@ idle(void *idle_started_ UNUSED)
         intr_disable();
         thread_block();
 
+        /* Sleep through the ticks with nothing to do. */
+        timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the
@@ -555,7 +695,6 @@ init_thread(struct thread *t, const char *name, int priority, struct thread *par
     t->magic = THREAD_MAGIC;
     list_push_back(&all_list, &t->allelem);
 
-    t->wakeup_tick = NULL;
     t->origin_priority = -1;
     t->blocker = NULL;
 
@@ -570,6 +709,8 @@ init_thread(struct thread *t, const char *name, int priority, struct thread *par
         t->recent_cpu = parent->recent_cpu;
     }
 
+    t->cpu_epoch = decay_epoch;
+
     list_init(&t->lock_list);
 #ifdef USERPROG
     t->parent = parent;
@@ -606,15 +747,74 @@ alloc_frame(struct thread *t, size_t size)
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   will be in the run queue.)  If the run queue is empty, returns
+   the idle thread. */
 static struct thread *
 next_thread_to_run(void)
 {
-    if (list_empty(&ready_list))
-        return idle_thread;
-    else
-        return list_entry(list_pop_back(&ready_list), struct thread, elem);
+    struct cpu *cpu = this_cpu();
+    struct thread *t = ready_pop(cpu);
+
+    return t != NULL ? t : cpu->idle_thread;
+}
+
+/* Adds T to the back of the run queue of its priority. */
+static void
+ready_push(struct thread *t)
+{
+    struct cpu *cpu = this_cpu();
+    int level = t->priority - PRI_MIN;
+
+    t->ready_priority = t->priority;
+    list_push_back(&cpu->ready_lists[level], &t->elem);
+    cpu->ready_bitmap[level / 32] |= 1u << (level % 32);
+    cpu->ready_cnt++;
+}
+
+/* Takes T off its run queue. */
+static void
+ready_remove(struct thread *t)
+{
+    struct cpu *cpu = this_cpu();
+    int level = t->ready_priority - PRI_MIN;
+
+    list_remove(&t->elem);
+    if (list_empty(&cpu->ready_lists[level]))
+        cpu->ready_bitmap[level / 32] &= ~(1u << (level % 32));
+    cpu->ready_cnt--;
+}
+
+/* Takes the highest priority thread off CPU's run queue and
+   returns it, or returns a null pointer if the queue is empty. */
+static struct thread *
+ready_pop(struct cpu *cpu)
+{
+    struct thread *t = NULL;
+    int priority;
+
+    priority = ready_max_priority(cpu);
+    if (priority >= PRI_MIN)
+    {
+        int level = priority - PRI_MIN;
+        t = list_entry(list_pop_front(&cpu->ready_lists[level]), struct thread, elem);
+        if (list_empty(&cpu->ready_lists[level]))
+            cpu->ready_bitmap[level / 32] &= ~(1u << (level % 32));
+        cpu->ready_cnt--;
+    }
+    return t;
+}
+
+/* Returns the highest priority of a thread in CPU's run queue, or
+   PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_max_priority(struct cpu *cpu)
+{
+    int i;
+
+    for (i = sizeof cpu->ready_bitmap / sizeof *cpu->ready_bitmap - 1; i >= 0; i--)
+        if (cpu->ready_bitmap[i] != 0)
+            return PRI_MIN + i * 32 + 31 - __builtin_clz(cpu->ready_bitmap[i]);
+    return PRI_MIN - 1;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -641,6 +841,7 @@ void thread_schedule_tail(struct thread *prev)
 
     /* Mark us as running. */
     cur->status = THREAD_RUNNING;
+    this_cpu()->running = cur;
 
     /* Start new time slice. */
     thread_ticks = 0;
@@ -681,7 +882,10 @@ schedule(void)
     ASSERT(is_thread(next));
 
     if (cur != next)
+    {
+        schedtrace_switch(cur, next);
         prev = switch_threads(cur, next);
+    }
     thread_schedule_tail(prev);
 }
 
@@ -703,26 +907,6 @@ allocate_tid(void)
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof(struct thread, stack);
 
-struct list *get_ready_list(void)
-{
-    return &ready_list;
-}
-
-struct list *get_sleep_list()
-{
-    return &sleep_list;
-}
-
-bool late(struct list_elem *a, struct list_elem *b, void *aux UNUSED)
-{
-    struct thread *t_a = list_entry(a, struct thread, elem);
-    struct thread *t_b = list_entry(b, struct thread, elem);
-
-    if (t_a->wakeup_tick <= t_b->wakeup_tick)
-        return true;
-    return false;
-}
-
 bool less_priority(struct list_elem *a, struct list_elem *b, void *aux UNUSED)
 {
     struct thread *t_a = list_entry(a, struct thread, elem);
@@ -735,5 +919,5 @@ bool less_priority(struct list_elem *a, struct list_elem *b, void *aux UNUSED)
 
 struct thread *get_idle(void)
 {
-    return idle_thread;
+    return this_cpu()->idle_thread;
 }
\ No newline at end of file
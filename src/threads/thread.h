@@ -5,8 +5,10 @@
 #include <list.h>
 #include <stdint.h>
 #include <hash.h>
+#include <vmstat.h>
 #include "threads/arithmetic.h"
 #include "threads/synch.h"
+#include "devices/timer.h"
 #include "filesys/file.h"
 #include "filesys/directory.h"
 
@@ -114,8 +116,17 @@ struct thread
     struct file *executed_file;
     int next_fd;
 
-    struct hash vm;
+    struct vma *vm; /* Tree of memory regions, see vm/vma.c. */
     struct list mmap_list;
+    uint8_t *ra_next; /* Expected next fault of a sequential reader. */
+    size_t ra_window; /* Current read-around window in pages. */
+    struct vmstat vmstat; /* VM event counters, see vm/vmstat.c. */
+    size_t oom_score;     /* Footprint, while the OOM killer runs. */
+    bool oom_killed;      /* Chosen by the OOM killer, see vm/oom.c. */
+    size_t wss_resident;   /* Counts of the working set sample in */
+    size_t wss_referenced; /* progress, see vm/wss.c. */
+    uint64_t wss_refaults; /* Pages read back, as of the last sample. */
+    bool thrashing;        /* Refaulting more than it keeps resident. */
 #endif
 
     /* Current directory. */
@@ -124,12 +135,19 @@ struct thread
     /* Owned by thread.c. */
     unsigned magic; /* Detects stack overflow. */
 
-    int64_t wakeup_tick;
+    struct timer sleep_timer; /* Wakes the thread from timer_sleep(). */
     int origin_priority;
     struct list lock_list;
     struct lock *blocker;
+    struct rwlock *rw_blocker;            /* Rwlock it waits to write. */
+    struct rw_hold rw_holds[RW_HOLD_MAX]; /* Rwlocks it holds to read. */
+    int ready_priority; /* Run queue the thread is on, while ready. */
     int nice;
     fixed_point recent_cpu;
+    int64_t cpu_epoch; /* Last decay applied to RECENT_CPU. */
+    bool cpu_charged;  /* Charged a tick since the last priority update. */
+    uint64_t wake_tsc; /* When woken, until it runs, if traced. */
+    uint64_t run_tsc;  /* When last switched to, if traced. */
 };
 
 /* If false (default), use round-robin scheduler.
@@ -157,6 +175,7 @@ const char *thread_name(void);
 void thread_exit(int) NO_RETURN;
 void thread_yield(void);
 void thread_priority_yield(void);
+void thread_requeue(struct thread *);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func(struct thread *t, void *aux);
@@ -169,14 +188,10 @@ void realloc_priority(struct thread *t, void *aux);
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
-void update_recent_cpu(void);
-void realloc_recent_cpu(struct thread *t, void *aux);
 int thread_get_load_avg(void);
 void update_load_avg(void);
+void thread_mlfqs_tick(int64_t ticks);
 
-struct list *get_ready_list(void);
-
-bool late(struct list_elem *a, struct list_elem *b, void *aux UNUSED);
 bool less_priority(struct list_elem *a, struct list_elem *b, void *aux UNUSED);
 struct thread *get_idle(void);
 
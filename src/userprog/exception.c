@@ -8,6 +8,8 @@
 #include "threads/interrupt.h"
 #include "threads/vaddr.h"
 #include "threads/thread.h"
+#include "vm/oom.h"
+#include "vm/vma.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -156,6 +158,8 @@ page_fault(struct intr_frame *f)
        which fault_addr refers. */
 
     struct thread *cur = thread_current();
+    if (user && oom_killed())
+        exit(-1);
     if (fault_addr == NULL || fault_addr >= PHYS_BASE)
     {
         f->eip = f->eax;
@@ -168,7 +172,7 @@ page_fault(struct intr_frame *f)
     {
         if (vme != NULL)
         {
-            if (!handle_mm_fault(vme))
+            if (!handle_mm_fault(vme, write))
                 exit(-1);
         }
         else
@@ -176,12 +180,11 @@ page_fault(struct intr_frame *f)
             /* Check stack access */
             if (fault_addr >= f->esp - 32)
             {
-                while (fault_addr < PHYS_BASE)
-                {
-                    if (find_vme(fault_addr) == NULL)
-                        expand_stack(fault_addr);
-                    fault_addr += PGSIZE;
-                }
+                if (!expand_stack(fault_addr) || (vme = find_vme(fault_addr)) == NULL)
+                    exit(-1);
+
+                if (!handle_mm_fault(vme, write))
+                    exit(-1);
             }
             else
                 exit(-1);
@@ -191,5 +194,9 @@ page_fault(struct intr_frame *f)
     {
         if (write && !vme->writable)
             exit(-1);
+
+        /* Write to the shared zero frame. */
+        if (write && !handle_mm_fault(vme, write))
+            exit(-1);
     }
 }
@@ -1,6 +1,7 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
@@ -9,6 +10,10 @@
 static uint32_t *active_pd(void);
 static void invalidate_pagedir(uint32_t *);
 
+/* Statistics. */
+static unsigned long long large_map_cnt;   /* User large pages mapped. */
+static unsigned long long large_split_cnt; /* Of those, split again. */
+
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
@@ -33,7 +38,9 @@ void pagedir_destroy(uint32_t *pd)
 
     ASSERT(pd != init_page_dir);
     for (pde = pd; pde < pd + pd_no(PHYS_BASE); pde++)
-        if (*pde & PTE_P)
+        if (pde_is_large(*pde))
+            palloc_free_multiple(pde_get_large_page(*pde), LARGE_PGCNT);
+        else if (*pde & PTE_P)
         {
             uint32_t *pt = pde_get_pt(*pde);
             uint32_t *pte;
@@ -51,7 +58,10 @@ void pagedir_destroy(uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR lies in a large page, the PDE mapping it is returned.
+   Its present, writable, user, accessed and dirty bits are at the
+   same positions as in a PTE. */
 static uint32_t *
 lookup_page(uint32_t *pd, const void *vaddr, bool create)
 {
@@ -78,6 +88,8 @@ lookup_page(uint32_t *pd, const void *vaddr, bool create)
         else
             return NULL;
     }
+    if (pde_is_large(*pde))
+        return pde;
 
     /* Return the page table entry. */
     pt = pde_get_pt(*pde);
@@ -127,6 +139,9 @@ pagedir_get_page(uint32_t *pd, const void *uaddr)
 
     ASSERT(is_user_vaddr(uaddr));
 
+    if (pde_is_large(pd[pd_no(uaddr)]))
+        return pde_get_large_page(pd[pd_no(uaddr)]) + ((uintptr_t)uaddr & (LARGE_PGSIZE - 1));
+
     pte = lookup_page(pd, uaddr, false);
     if (pte != NULL && (*pte & PTE_P) != 0)
         return pte_get_page(*pte) + pg_ofs(uaddr);
@@ -137,13 +152,15 @@ pagedir_get_page(uint32_t *pd, const void *uaddr)
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
-   UPAGE need not be mapped. */
+   UPAGE need not be mapped, but must not lie in a large page;
+   use pagedir_split_large_page() first. */
 void pagedir_clear_page(uint32_t *pd, void *upage)
 {
     uint32_t *pte;
 
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(is_user_vaddr(upage));
+    ASSERT(!pde_is_large(pd[pd_no(upage)]));
 
     pte = lookup_page(pd, upage, false);
     if (pte != NULL && (*pte & PTE_P) != 0)
@@ -153,6 +170,78 @@ void pagedir_clear_page(uint32_t *pd, void *upage)
     }
 }
 
+/* Maps the LARGE_PGSIZE bytes of user virtual memory starting at
+   UPAGE with a single large page, to the block of LARGE_PGCNT
+   frames starting at KPAGE, obtained from palloc_get_large().
+   The region may already have a page table, but no page in it
+   may be present; the page table is freed.  Returns true if
+   successful, false if some page in the region is mapped. */
+bool pagedir_set_large_page(uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+    uint32_t *pde = pd + pd_no(upage);
+
+    ASSERT(((uintptr_t)upage & (LARGE_PGSIZE - 1)) == 0);
+    ASSERT(is_user_vaddr(upage));
+    ASSERT(is_user_vaddr((uint8_t *)upage + LARGE_PGSIZE - 1));
+    ASSERT(pd != init_page_dir);
+
+    if (pde_is_large(*pde))
+        return false;
+    if (*pde & PTE_P)
+    {
+        uint32_t *pt = pde_get_pt(*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+            if (pt[i] & PTE_P)
+                return false;
+        *pde = 0;
+        invalidate_pagedir(pd);
+        palloc_free_page(pt);
+    }
+
+    *pde = pde_create_large(kpage, writable, true);
+    large_map_cnt++;
+    return true;
+}
+
+/* If user virtual address VADDR lies in a large page in PD,
+   replaces that mapping by a page table that maps the same frames
+   with small pages, so that they can be unmapped one by one.  Each
+   PTE inherits the large page's accessed and dirty bits.  Returns
+   false if out of memory for the page table, true otherwise. */
+bool pagedir_split_large_page(uint32_t *pd, const void *vaddr)
+{
+    uint32_t *pde = pd + pd_no(vaddr);
+    uint32_t *pt;
+    uint8_t *kpage;
+    size_t i;
+
+    ASSERT(is_user_vaddr(vaddr));
+    if (!pde_is_large(*pde))
+        return true;
+
+    pt = palloc_get_page(PAL_ZERO);
+    if (pt == NULL)
+        return false;
+
+    kpage = pde_get_large_page(*pde);
+    for (i = 0; i < PGSIZE / sizeof *pt; i++)
+        pt[i] = pte_create_user(kpage + i * PGSIZE, (*pde & PTE_W) != 0) | (*pde & (PTE_A | PTE_D));
+    *pde = pde_create(pt);
+    invalidate_pagedir(pd);
+    large_split_cnt++;
+    return true;
+}
+
+/* Prints large page statistics, if large pages are enabled. */
+void pagedir_print_stats(void)
+{
+    if (large_pages)
+        printf("Paging: %llu large pages mapped, %llu split\n",
+               large_map_cnt, large_split_cnt);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
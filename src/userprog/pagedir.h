@@ -13,6 +13,9 @@ bool pagedir_is_dirty(uint32_t *pd, const void *upage);
 void pagedir_set_dirty(uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed(uint32_t *pd, const void *upage);
 void pagedir_set_accessed(uint32_t *pd, const void *upage, bool accessed);
+bool pagedir_set_large_page(uint32_t *pd, void *upage, void *kpage, bool writable);
+bool pagedir_split_large_page(uint32_t *pd, const void *vaddr);
 void pagedir_activate(uint32_t *pd);
+void pagedir_print_stats(void);
 
 #endif /* userprog/pagedir.h */
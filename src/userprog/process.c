@@ -9,6 +9,7 @@
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "userprog/syscall.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -17,12 +18,17 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/share.h"
 #include "vm/swap.h"
+#include "vm/vma.h"
+#include "vm/vmstat.h"
+#include "vm/wss.h"
 
 struct arg
 {
@@ -137,6 +143,9 @@ void process_exit(void)
     uint32_t *pd;
     int i;
 
+    if (vmstat_dump && cur->pagedir != NULL)
+        vmstat_print(cur->name, &cur->vmstat);
+
     /* munmap */
     munmap(INT32_MAX);
 
@@ -145,6 +154,7 @@ void process_exit(void)
 
     /* Free pages thread has */
     free_thread_pages(cur);
+    wss_exit(cur);
 
     /* Destroy the current process's page directory and switch back
        to the kernel-only page directory. */
@@ -383,6 +393,9 @@ done:
 /* load() helpers. */
 
 static bool install_page(void *upage, void *kpage, bool writable);
+static bool map_large_page(struct vm_entry *vme);
+static bool map_zeroed_page(struct vm_entry *vme);
+static bool fault_in(struct vm_entry *vme, bool write);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -451,43 +464,9 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(ofs % PGSIZE == 0);
 
-    file_seek(file, ofs);
-    while (read_bytes > 0 || zero_bytes > 0)
-    {
-        /* Calculate how to fill this page.
-           We will read PAGE_READ_BYTES bytes from FILE
-           and zero the final PAGE_ZERO_BYTES bytes. */
-        size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-        size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-        /* Create vm_entry(Use malloc) */
-        struct vm_entry *vme = malloc(sizeof(struct vm_entry));
-
-        /* Setting vm_entry members,
-           offset and size of file to read when virtual page is required,
-           zero byte to pad at the end, … */
-        vme->file = file;
-        vme->vaddr = upage;
-        vme->read_bytes = page_read_bytes;
-        vme->zero_bytes = page_zero_bytes;
-        vme->offset = file->pos;
-        vme->writable = writable;
-        vme->type = VM_BIN;
-        vme->sec_idx = -1;
-
-        file_seek(file, file_tell(file) + page_read_bytes);
-
-        /* Add vm_entry to hash table by insert_vme() */
-        struct thread *cur = thread_current();
-        if (!insert_vme(&cur->vm, vme))
-            return false;
-
-        /* Advance. */
-        read_bytes -= page_read_bytes;
-        zero_bytes -= page_zero_bytes;
-        upage += PGSIZE;
-    }
-    return true;
+    /* Pages are described by the segment's region and read in
+       when first touched. */
+    return vma_create(upage, upage + read_bytes + zero_bytes, VM_BIN, file, ofs, read_bytes, writable) != NULL;
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
@@ -496,36 +475,32 @@ static bool
 setup_stack(void **esp)
 {
     bool success = false;
+    uint8_t *upage = (uint8_t *)PHYS_BASE - PGSIZE;
+
+    /* The stack region reserves MAX_STACK_SIZE bytes but starts out
+       one page long; expand_stack() grows it. */
+    struct vma *vma = vma_create(PHYS_BASE - MAX_STACK_SIZE, PHYS_BASE, VM_ANON, NULL, 0, 0, true);
+    if (vma == NULL)
+        return false;
+    vma->start = upage;
+
+    struct vm_entry *vme = find_vme(upage);
+    if (vme == NULL)
+        return false;
 
     struct page *page = alloc_page(PAL_USER | PAL_ZERO);
     if (page != NULL)
     {
-        success = install_page(((uint8_t *)PHYS_BASE) - PGSIZE, page->kaddr, true);
+        page->vme = vme;
+        success = install_page(upage, page->kaddr, true);
         if (success)
+        {
             *esp = PHYS_BASE;
+            activate_page(page);
+        }
         else
             free_page(page);
     }
-
-    /* Create vm_entry */
-    struct vm_entry *vme = malloc(sizeof(struct vm_entry));
-    page->vme = vme;
-
-    /* Set up vm_entry members */
-    vme->file = NULL;
-    vme->vaddr = (uint8_t *)PHYS_BASE - PGSIZE;
-    vme->read_bytes = PGSIZE;
-    vme->zero_bytes = 0;
-    vme->offset = 0;
-    vme->writable = true;
-    vme->type = VM_ANON;
-    vme->sec_idx = -1;
-
-    /* Using insert_vme(), add vm_enty to hash table */
-    struct thread *cur = thread_current();
-    if (!insert_vme(&cur->vm, vme))
-        return false;
-
     return success;
 }
 
@@ -618,12 +593,168 @@ struct thread *find_child(tid_t child_tid)
     return NULL;
 }
 
-bool handle_mm_fault(struct vm_entry *vme)
+/* Returns true if NEXT, DIST pages after VME, is not resident and
+   its backing store directly follows that of VME, whose swap slot
+   was SEC_IDX at fault time.  Must be called with lru_list_lock
+   held. */
+static bool
+vme_follows(struct vm_entry *vme, size_t sec_idx, struct vm_entry *next, size_t dist)
+{
+    if (next == NULL || next->in_transit || next->type != vme->type || next->zentry != NULL)
+        return false;
+    if (pagedir_get_page(thread_current()->pagedir, next->vaddr) != NULL)
+        return false;
+
+    if (vme->type == VM_ANON && sec_idx != SWAP_SLOT_NONE)
+        return next->sec_idx == sec_idx + dist;
+
+    return next->sec_idx == SWAP_SLOT_NONE && next->file == vme->file && next->read_bytes > 0 && next->offset == vme->offset + dist * PGSIZE;
+}
+
+/* Speculatively brings in the pages following VME whose swap
+   slots or file offsets are contiguous with it.  The window grows
+   while the process keeps faulting sequentially and collapses on a
+   random fault.  Regions advised MADV_RANDOM get no read-ahead,
+   those advised MADV_SEQUENTIAL the full window.  Only free frames
+   are used, and the pages are mapped with the accessed bit clear so
+   that the replacement policy can take them back if they are never
+   touched. */
+static void
+fault_around(struct vm_entry *vme, size_t sec_idx)
+{
+    struct thread *cur = thread_current();
+    struct vma *vma = find_vma(vme->vaddr);
+    size_t i;
+
+    if (vma->advice == MADV_RANDOM)
+        return;
+
+    if (vma->advice == MADV_SEQUENTIAL)
+        cur->ra_window = RA_WINDOW_MAX;
+    else if (vme->vaddr == cur->ra_next && cur->ra_window < RA_WINDOW_MAX)
+        cur->ra_window *= 2;
+    else if (vme->vaddr != cur->ra_next)
+        cur->ra_window = RA_WINDOW_MIN;
+
+    for (i = 1; i <= cur->ra_window; i++)
+    {
+        uint8_t *vaddr = vme->vaddr + i * PGSIZE;
+        if (!is_user_vaddr(vaddr))
+            break;
+
+        struct vm_entry *next = find_vme(vaddr);
+        lock_acquire(&lru_list.lru_list_lock);
+        if (!vme_follows(vme, sec_idx, next, i))
+        {
+            lock_release(&lru_list.lru_list_lock);
+            break;
+        }
+
+        if (vme_is_shareable(next))
+        {
+            struct page *shared = share_lookup(next);
+            if (shared != NULL)
+            {
+                bool mapped = share_map(shared, next);
+                lock_release(&lru_list.lru_list_lock);
+                if (!mapped)
+                    break;
+                continue;
+            }
+        }
+        lock_release(&lru_list.lru_list_lock);
+
+        struct page *page = try_alloc_page(PAL_USER);
+        if (page == NULL)
+            break;
+        page->vme = next;
+
+        if (sec_idx != SWAP_SLOT_NONE)
+        {
+            swap_in(next->sec_idx, page->kaddr);
+            next->sec_idx = SWAP_SLOT_NONE;
+        }
+        else if (!load_file(page->kaddr, next))
+        {
+            free_page(page);
+            break;
+        }
+
+        if (!install_page(next->vaddr, page->kaddr, next->writable))
+        {
+            free_page(page);
+            break;
+        }
+        activate_page(page);
+    }
+
+    cur->ra_next = vme->vaddr + i * PGSIZE;
+}
+
+/* Brings in the page described by VME.  WRITE is true if the
+   faulting access was a write.  Zero-fill pages are first mapped
+   to the shared zero frame on a read and only get a frame of
+   their own once they are written.  Does nothing if the page is
+   already resident, for instance because an earlier fault read it
+   around.
+
+   lru_list_lock is only held while looking at the page tables and
+   the share table.  The new frame stays in transit while it is
+   read in, so that faults in other processes, and evictions of
+   other frames, proceed during the I/O. */
+static bool
+fault_in(struct vm_entry *vme, bool write)
 {
     bool success = false;
+    uint32_t *pd = thread_current()->pagedir;
 
-    /* Allocate page. */
     lock_acquire(&lru_list.lru_list_lock);
+    vme_wait_transit(vme);
+
+    size_t sec_idx = vme->sec_idx;
+    void *kaddr = pagedir_get_page(pd, vme->vaddr);
+    if (kaddr != NULL && kaddr != lru_list.zero_page)
+    {
+        lock_release(&lru_list.lru_list_lock);
+        return true;
+    }
+    if (kaddr == lru_list.zero_page)
+    {
+        /* Copy on write of the zero frame. */
+        if (!write)
+        {
+            lock_release(&lru_list.lru_list_lock);
+            return true;
+        }
+        pagedir_clear_page(pd, vme->vaddr);
+    }
+
+    if (vme_is_shareable(vme))
+    {
+        /* Another process may already have this page in memory. */
+        struct page *shared = share_lookup(vme);
+        if (shared != NULL)
+        {
+            success = share_map(shared, vme);
+            if (success)
+                pagedir_set_accessed(pd, vme->vaddr, true);
+            lock_release(&lru_list.lru_list_lock);
+
+            if (success)
+                fault_around(vme, sec_idx);
+            return success;
+        }
+    }
+    lock_release(&lru_list.lru_list_lock);
+
+    if (vme_is_zero_fill(vme))
+    {
+        if (write)
+            return map_zeroed_page(vme);
+        return install_page(vme->vaddr, lru_list.zero_page, false);
+    }
+
+    /* Allocate page. */
     struct page *page = alloc_page(PAL_USER);
     if (page == NULL)
         return success;
@@ -647,69 +778,130 @@ bool handle_mm_fault(struct vm_entry *vme)
     }
     case VM_ANON:
     {
-        if (vme->sec_idx == -1 && vme->file != NULL)
+        if (vme->zentry != NULL)
+        {
+            zswap_load(vme->zentry, page->kaddr);
+            vme->zentry = NULL;
+        }
+        else if (vme->sec_idx == SWAP_SLOT_NONE && vme->file != NULL)
             load_file(page->kaddr, vme);
         else
+        {
             swap_in(vme->sec_idx, page->kaddr);
+            vme->sec_idx = SWAP_SLOT_NONE;
+        }
         break;
     }
     default:
-    {
-        return expand_stack(vme->vaddr);
-        break;
-    }
+        goto done;
     }
 
     /* Update page table entry. */
     success = install_page(vme->vaddr, page->kaddr, vme->writable);
     pagedir_set_accessed(page->thread->pagedir, page->vme->vaddr, true);
-    lock_release(&lru_list.lru_list_lock);
 
 done:
     if (!success)
+    {
         free_page(page);
+        return success;
+    }
 
+    activate_page(page);
+    fault_around(vme, sec_idx);
     return success;
 }
 
-bool expand_stack(void *addr)
+/* Brings in the page of VME, as fault_in() does, and accounts the
+   fault in the VM counters and the fault tracer. */
+bool handle_mm_fault(struct vm_entry *vme, bool write)
 {
-    lock_acquire(&lru_list.lru_list_lock);
+    enum vm_type type = vme->type;
+    uint64_t start = timer_cycles();
+    bool success = fault_in(vme, write);
 
-    bool success = false;
-    void *vaddr = pg_round_down(addr);
-    /* Check stack max size. */
-    if (vaddr < PHYS_BASE - MAX_STACK_SIZE)
-        return success;
+    vmstat_fault(vme->vaddr, type, write, success, start);
+    return success;
+}
 
-    struct page *page = alloc_page(PAL_USER | PAL_ZERO);
-    if (page != NULL)
+/* Backs the whole large page around VME with a single 4 MB
+   mapping, if every page in it is an untouched, writable zero-fill
+   page.  Returns false, leaving the caller to fall back to a small
+   page, if not or if the user pool has no aligned block free. */
+static bool
+map_large_page(struct vm_entry *vme)
+{
+    uint32_t *pd = thread_current()->pagedir;
+    uint8_t *base = (uint8_t *)((uintptr_t)vme->vaddr & ~(uintptr_t)(LARGE_PGSIZE - 1));
+    size_t i;
+
+    if (!is_user_vaddr(base + LARGE_PGSIZE - 1))
+        return false;
+    for (i = 0; i < LARGE_PGCNT; i++)
     {
-        success = install_page(vaddr, page->kaddr, true);
-        if (!success)
-            free_page(page);
+        struct vm_entry *e = find_vme(base + i * PGSIZE);
+        if (e == NULL || !e->writable || !vme_is_zero_fill(e))
+            return false;
+
+        void *kaddr = pagedir_get_page(pd, e->vaddr);
+        if (kaddr != NULL && kaddr != lru_list.zero_page)
+            return false;
     }
 
-    /* Create vm_entry */
-    struct vm_entry *vme = malloc(sizeof(struct vm_entry));
-    page->vme = vme;
+    struct page *page = alloc_large_page(base);
+    if (page == NULL)
+        return false;
 
-    /* Set up vm_entry members */
-    vme->file = NULL;
-    vme->vaddr = vaddr;
-    vme->read_bytes = PGSIZE;
-    vme->zero_bytes = 0;
-    vme->offset = 0;
-    vme->writable = true;
-    vme->type = VM_ANON;
-    vme->sec_idx = -1;
-
-    /* Add vm_enty to hash table */
-    struct thread *cur = thread_current();
-    if (!insert_vme(&cur->vm, vme))
+    for (i = 0; i < LARGE_PGCNT; i++)
+        if (pagedir_get_page(pd, base + i * PGSIZE) == lru_list.zero_page)
+            pagedir_clear_page(pd, base + i * PGSIZE);
+
+    if (!pagedir_set_large_page(pd, base, page->kaddr, true))
+    {
+        free_large_page(page);
         return false;
+    }
+    pagedir_set_accessed(pd, vme->vaddr, true);
+    activate_large_page(page);
+    return true;
+}
 
-    lock_release(&lru_list.lru_list_lock);
+/* Maps a freshly zeroed, writable frame at VME's address, or a
+   whole large page around it if enabled and possible. */
+static bool
+map_zeroed_page(struct vm_entry *vme)
+{
+    if (large_pages && vme->writable && map_large_page(vme))
+        return true;
 
-    return success;
+    struct page *page = alloc_page(PAL_USER | PAL_ZERO);
+    if (page == NULL)
+        return false;
+
+    page->vme = vme;
+    if (!install_page(vme->vaddr, page->kaddr, vme->writable))
+    {
+        free_page(page);
+        return false;
+    }
+    pagedir_set_accessed(page->thread->pagedir, vme->vaddr, true);
+    activate_page(page);
+    return true;
+}
+
+/* Grows the stack down to the page containing ADDR.  No frames
+   are allocated until the pages are faulted in.  Returns false if
+   ADDR is outside the stack's reservation. */
+bool expand_stack(void *addr)
+{
+    struct vma *vma = find_vma(addr);
+    if (vma == NULL || vma->end != PHYS_BASE)
+        return false;
+
+    if ((uint8_t *)pg_round_down(addr) < vma->start)
+    {
+        vma->start = pg_round_down(addr);
+        vmstat_count(thread_current(), VMC_STACK_GROW, 1);
+    }
+    return true;
 }
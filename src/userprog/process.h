@@ -6,12 +6,16 @@
 
 #define MAX_STACK_SIZE (1 << 23)
 
+/* Bounds of the read-around window used by handle_mm_fault(). */
+#define RA_WINDOW_MIN 1
+#define RA_WINDOW_MAX 16
+
 tid_t process_execute(const char *file_name);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(void);
 struct thread *find_child(tid_t child_tid);
-bool handle_mm_fault(struct vm_entry *vme);
+bool handle_mm_fault(struct vm_entry *vme, bool write);
 bool expand_stack(void *addr);
 
 #endif /* userprog/process.h */
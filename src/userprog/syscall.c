@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <round.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -10,9 +11,16 @@
 #include "userprog/process.h"
 #include "devices/shutdown.h"
 #include "devices/input.h"
+#include "filesys/cache.h"
 #include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "vm/frame.h"
+#include "vm/oom.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+#include "vm/vmstat.h"
+#include "vm/writeback.h"
 
 static void syscall_handler(struct intr_frame *);
 static void is_valid_addr(uint32_t *vaddr);
@@ -29,7 +37,10 @@ static int write(int fd, const void *buffer, unsigned size);
 static void seek(int fd, unsigned position);
 static unsigned tell(int fd);
 static void close(int fd);
-static int mmap(int fd, void *addr);
+static int mmap(int fd, void *addr, int flags);
+static int madvise(void *addr, unsigned length, int advice);
+static int msync(void *addr, unsigned length, int flags);
+static int vmstat(int which, void *buffer, unsigned size);
 static bool chdir(const char *dir);
 static bool mkdir(const char *dir);
 static bool readdir(int fd, char *name);
@@ -38,7 +49,6 @@ static int inumber(int fd);
 
 void syscall_init(void)
 {
-    lock_init(&filesys_lock);
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -50,6 +60,8 @@ syscall_handler(struct intr_frame *f)
     struct thread *cur = thread_current();
     if (esp == NULL || esp >= PHYS_BASE || pagedir_get_page(cur->pagedir, esp) == NULL)
         exit(-1);
+    if (oom_killed())
+        exit(-1);
 
     switch (*(uint32_t *)esp)
     {
@@ -121,7 +133,7 @@ syscall_handler(struct intr_frame *f)
     }
     case SYS_MMAP: /* Map a file into memory. */
     {
-        f->eax = mmap(*(uint32_t *)(esp + 16), *(uint32_t *)(esp + 20));
+        f->eax = mmap(*(uint32_t *)(esp + 16), *(uint32_t *)(esp + 20), 0);
         break;
     }
     case SYS_MUNMAP: /* Remove a memory mapping. */
@@ -154,11 +166,34 @@ syscall_handler(struct intr_frame *f)
         f->eax = inumber(*(uint32_t *)(esp + 4));
         break;
     }
+    case SYS_MMAP_FLAGS: /* Map a file into memory, with flags. */
+    {
+        f->eax = mmap(*(uint32_t *)(esp + 20), *(uint32_t *)(esp + 24), *(uint32_t *)(esp + 28));
+        break;
+    }
+    case SYS_MADVISE: /* Advise on use of mapped memory. */
+    {
+        f->eax = madvise(*(uint32_t *)(esp + 20), *(uint32_t *)(esp + 24), *(uint32_t *)(esp + 28));
+        break;
+    }
+    case SYS_MSYNC: /* Write mapped memory back to its file. */
+    {
+        f->eax = msync(*(uint32_t *)(esp + 20), *(uint32_t *)(esp + 24), *(uint32_t *)(esp + 28));
+        break;
+    }
+    case SYS_VMSTAT: /* Read VM counters or the fault trace. */
+    {
+        f->eax = vmstat(*(uint32_t *)(esp + 20), *(uint32_t *)(esp + 24), *(uint32_t *)(esp + 28));
+        break;
+    }
+    case SYS_LOCKSTAT: /* Print lock contention statistics. */
+    {
+        lock_print_stats();
+        break;
+    }
     default:
         break;
     }
-
-    unpin_page();
 }
 
 static void is_valid_addr(uint32_t *vaddr)
@@ -272,11 +307,10 @@ static int filesize(int fd)
 
 static int read(int fd, void *buffer, unsigned size)
 {
-    lock_acquire(&filesys_lock);
-    unpin_page();
+    struct pin_set pins;
 
     int size_read = -1;
-    check_valid_buffer(buffer, size);
+    check_valid_buffer(buffer, size, &pins);
 
     if (fd == 0)
         size_read = input_getc();
@@ -290,19 +324,17 @@ static int read(int fd, void *buffer, unsigned size)
         }
     }
 
-    unpin_page();
-    lock_release(&filesys_lock);
+    unpin_buffer(&pins);
 
     return size_read;
 }
 
 static int write(int fd, const void *buffer, unsigned size)
 {
-    lock_acquire(&filesys_lock);
-    unpin_page();
+    struct pin_set pins;
 
     int size_written = -1;
-    check_valid_buffer(buffer, size);
+    check_valid_buffer(buffer, size, &pins);
 
     if (fd == 1)
         putbuf(buffer, size);
@@ -313,14 +345,16 @@ static int write(int fd, const void *buffer, unsigned size)
         {
             struct file *file = cur->fdt[fd];
             if (inode_is_dir(file->inode))
+            {
+                unpin_buffer(&pins);
                 exit(-1);
+            }
 
             size_written = file_write(file, buffer, size);
         }
     }
 
-    unpin_page();
-    lock_release(&filesys_lock);
+    unpin_buffer(&pins);
 
     return size_written;
 }
@@ -355,7 +389,7 @@ static void close(int fd)
     }
 }
 
-static int mmap(int fd, void *addr)
+static int mmap(int fd, void *addr, int flags)
 {
     /* Null checking */
     if (addr == NULL)
@@ -365,50 +399,143 @@ static int mmap(int fd, void *addr)
     if (fd < 0 || fd > 128)
         return -1;
 
-    /* Disallow overlap */
-    if (find_vme(addr) != NULL)
-        return -1;
-
     /* Check alignment */
     if (pg_ofs(addr) != 0)
         return -1;
 
     struct thread *cur = thread_current();
     struct file *file = cur->fdt[fd];
+    if (file == NULL)
+        return -1;
+
+    /* Disallow overlap */
+    off_t length = file_length(file);
+    uint8_t *end = (uint8_t *)addr + ROUND_UP(length, PGSIZE);
+    if (length == 0 || end <= (uint8_t *)addr || !is_user_vaddr(end - 1))
+        return -1;
+
     struct file *reopened_file = file_reopen(file);
-    int mapid = cur->next_fd++;
-    cur->fdt[mapid] = reopened_file;
+    if (reopened_file == NULL)
+        return -1;
+
+    /* Pages are described by the region until they are touched. */
+    struct vma *vma = vma_create(addr, end, VM_FILE, reopened_file, 0, length, true);
+    if (vma == NULL)
+    {
+        file_close(reopened_file);
+        return -1;
+    }
 
-    struct mmap_file *mmap_file = malloc(sizeof(struct mmap_file));
-    mmap_file->mapid = mapid;
-    mmap_file->file = reopened_file;
-    list_push_front(&cur->mmap_list, &mmap_file->elem);
-    list_init(&mmap_file->vme_list);
+    vma->mapid = cur->next_fd++;
+    cur->fdt[vma->mapid] = reopened_file;
+    list_push_front(&cur->mmap_list, &vma->mmap_elem);
 
-    uint32_t read_bytes = file_length(reopened_file);
-    while (read_bytes > 0)
+    if (flags & MAP_POPULATE)
     {
-        size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-        size_t page_zero_bytes = PGSIZE - page_read_bytes;
+        /* Skip pages already read around.  Stop if memory runs out;
+           the rest faults in lazily. */
+        uint8_t *upage;
+        for (upage = addr; upage < end; upage += PGSIZE)
+        {
+            struct vm_entry *vme = find_vme(upage);
+            if (pagedir_get_page(cur->pagedir, upage) != NULL)
+                continue;
+            if (vme == NULL || !handle_mm_fault(vme, false))
+                break;
+        }
+    }
+
+    return vma->mapid;
+}
+
+/* Applies ADVICE to the LENGTH bytes of mapped memory starting at
+   page ADDR.  MADV_RANDOM, MADV_SEQUENTIAL and MADV_NORMAL set the
+   read-ahead policy of every region in the range.
+   MADV_WILLNEED reads the range in now, MADV_DONTNEED makes its
+   frames the next ones evicted; neither discards any data.
+   Returns 0 if successful, -1 if part of the range is unmapped. */
+static int madvise(void *addr, unsigned length, int advice)
+{
+    uint32_t *pd = thread_current()->pagedir;
+    uint8_t *upage;
+
+    if (pg_ofs(addr) != 0 || advice < MADV_NORMAL || advice > MADV_DONTNEED)
+        return -1;
+
+    for (upage = addr; upage < (uint8_t *)addr + length; upage += PGSIZE)
+    {
+        if (upage < (uint8_t *)addr || !is_user_vaddr(upage))
+            return -1;
+
+        struct vm_entry *vme = find_vme(upage);
+        if (vme == NULL)
+            return -1;
+
+        switch (advice)
+        {
+        case MADV_WILLNEED:
+        {
+            /* Leave the accessed bit clear, as read-ahead does. */
+            if (pagedir_get_page(pd, upage) == NULL && handle_mm_fault(vme, false))
+                pagedir_set_accessed(pd, upage, false);
+            break;
+        }
+        case MADV_DONTNEED:
+        {
+            deactivate_page(upage);
+            break;
+        }
+        default:
+        {
+            find_vma(upage)->advice = advice;
+            break;
+        }
+        }
+    }
+
+    return 0;
+}
 
-        struct vm_entry *vme = malloc(sizeof(struct vm_entry));
-        list_push_back(&mmap_file->vme_list, &vme->mmap_elem);
-        vme->file = reopened_file;
-        vme->vaddr = addr;
-        vme->read_bytes = page_read_bytes;
-        vme->zero_bytes = page_zero_bytes;
-        vme->offset = reopened_file->pos;
-        vme->writable = true;
-        vme->type = VM_FILE;
+/* Writes the dirty pages of the file mappings covering the LENGTH
+   bytes starting at page ADDR back to their files.  With MS_SYNC
+   the data is on disk when this returns.  MS_ASYNC leaves it to
+   background writeback, which gets to it within
+   WRITEBACK_INTERVAL.  Returns 0 if successful, -1 if part of the
+   range is not file-mapped. */
+static int msync(void *addr, unsigned length, int flags)
+{
+    uint8_t *end = (uint8_t *)addr + ROUND_UP(length, PGSIZE);
+    uint8_t *upage;
+    struct vma *vma;
+
+    if (pg_ofs(addr) != 0 || end < (uint8_t *)addr || (flags != MS_ASYNC && flags != MS_SYNC))
+        return -1;
 
-        file_seek(reopened_file, file_tell(reopened_file) + page_read_bytes);
-        bool success = insert_vme(&cur->vm, vme);
+    for (upage = addr; upage < end; upage = vma->end)
+    {
+        vma = is_user_vaddr(upage) ? find_vma(upage) : NULL;
+        if (vma == NULL || vma->mapid == -1)
+            return -1;
+    }
 
-        read_bytes -= page_read_bytes;
-        addr += PGSIZE;
+    if (flags == MS_SYNC)
+    {
+        writeback_dirty(thread_current(), addr, end);
+        bc_sync();
     }
+    return 0;
+}
 
-    return mmap_file->mapid;
+/* Copies the VM counters or fault trace selected by WHICH into
+   BUFFER, see lib/vmstat.h.  Returns the number of bytes copied, or
+   -1 if WHICH is invalid. */
+static int vmstat(int which, void *buffer, unsigned size)
+{
+    struct pin_set pins;
+    check_valid_buffer(buffer, size, &pins);
+    int result = vmstat_read(which, buffer, size);
+    unpin_buffer(&pins);
+    return result;
 }
 
 void munmap(int mapid)
@@ -417,19 +544,19 @@ void munmap(int mapid)
 
     if (!list_empty(mmap_list))
     {
-        struct mmap_file *mf;
+        struct vma *vma;
         struct list_elem *e = list_begin(mmap_list);
         while (e != list_end(mmap_list))
         {
             struct list_elem *next = list_next(e);
 
-            mf = list_entry(e, struct mmap_file, elem);
-            if (mf->mapid == mapid || mapid == INT32_MAX)
+            vma = list_entry(e, struct vma, mmap_elem);
+            if (vma->mapid == mapid || mapid == INT32_MAX)
             {
-                mmunmap_file(mf);
+                int id = vma->mapid;
                 list_remove(e);
-                free(mf);
-                close(mf->mapid);
+                mmunmap_file(vma);
+                close(id);
             }
 
             e = next;
@@ -5,8 +5,6 @@
 
 typedef int pid_t;
 
-struct lock filesys_lock;
-
 void syscall_init(void);
 void exit(int status);
 void munmap(int mapid);
@@ -1,79 +1,512 @@
 #include "vm/frame.h"
+#include "vm/oom.h"
 #include "threads/malloc.h"
+#include "threads/pte.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "vm/share.h"
 #include "vm/swap.h"
+#include "vm/vma.h"
+#include "vm/vmstat.h"
+#include "vm/writeback.h"
+#include "vm/wss.h"
+#include "vm/zswap.h"
+
+static size_t evict_pages(bool *busy);
+static bool transit_pending(void);
+
+static struct lock_class lru_lock_class = LOCK_CLASS_INITIALIZER("lru list", 0);
 
 void lru_list_init(void)
 {
     list_init(&lru_list.page_list);
-    lock_init(&lru_list.lru_list_lock);
+    lock_init_class(&lru_list.lru_list_lock, &lru_lock_class);
+    cond_init(&lru_list.transit_cond);
     lru_list.lru_clock = NULL;
+    lru_list.page_cnt = 0;
+    lru_list.evict_cnt = 0;
+    lru_list.zero_page = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 }
 
 void lru_list_push_back(struct page *page)
 {
     list_push_back(&lru_list.page_list, &page->lru);
+    lru_list.page_cnt++;
 }
 
 void lru_list_remove(struct page *page)
 {
+    /* Keep the clock hand off removed pages. */
+    if (lru_list.lru_clock == &page->lru)
+        lru_list.lru_clock = list_next(&page->lru);
+
     list_remove(&page->lru);
+    lru_list.page_cnt--;
+}
+
+/* Sets up PAGE for frame KADDR and adds it to the LRU list.  The
+   page starts out in transit, so it is not evicted before the
+   caller has filled and mapped it and called activate_page(). */
+static void init_page(struct page *page, void *kaddr)
+{
+    page->kaddr = kaddr;
+    page->vme = NULL;
+    page->thread = thread_current();
+    page->pin_cnt = 0;
+    page->in_transit = true;
+    page->referenced = false;
+    page->share = NULL;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    lru_list_push_back(page);
+    lock_release(&lru_list.lru_list_lock);
 }
 
+/* Allocates a user frame, evicting other frames as needed.  When
+   nothing can be evicted for a while, invokes the OOM killer.
+   Waiting for frames that are only busy with I/O does not count
+   toward that.  Returns a null pointer if the current process is,
+   or becomes, its victim. */
 struct page *alloc_page(enum palloc_flags flags)
 {
     struct page *page = malloc(sizeof(struct page));
     if (page == NULL)
         return NULL;
 
-    void *kaddr;
-    do
+    size_t failures = 0;
+    void *kaddr = palloc_get_page(flags);
+    if (kaddr == NULL)
     {
+        wss_throttle();
         kaddr = palloc_get_page(flags);
-        if (kaddr != NULL)
-            break;
+    }
+    while (kaddr == NULL)
+    {
+        if (oom_killed())
+        {
+            free(page);
+            return NULL;
+        }
+
+        bool busy = false;
+        if (evict_pages(&busy) > 0)
+            failures = 0;
+        else if (!busy && ++failures >= OOM_RECLAIM_RETRIES)
+        {
+            /* Give the victim the same number of tries to exit
+               before checking on it again. */
+            oom_kill();
+            failures = 0;
+        }
+        kaddr = palloc_get_page(flags);
+    }
+
+    init_page(page, kaddr);
+    return page;
+}
+
+/* Like alloc_page(), but returns a null pointer instead of
+   evicting anything when no frame is free. */
+struct page *try_alloc_page(enum palloc_flags flags)
+{
+    void *kaddr = palloc_get_page(flags);
+    if (kaddr == NULL)
+        return NULL;
+
+    struct page *page = malloc(sizeof(struct page));
+    if (page == NULL)
+    {
+        palloc_free_page(kaddr);
+        return NULL;
+    }
+
+    init_page(page, kaddr);
+    return page;
+}
+
+/* Moves the frame mapped at user address VADDR of the current
+   thread right under the clock hand, with its accessed bit clear,
+   so that it is the next one evicted.  Shared, pinned and
+   in-transit frames are left alone. */
+void deactivate_page(void *vaddr)
+{
+    uint32_t *pd = thread_current()->pagedir;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    void *kaddr = pagedir_get_page(pd, vaddr);
+    struct page *page = kaddr != NULL ? find_page(kaddr) : NULL;
+    if (page != NULL && page->share == NULL && page->pin_cnt == 0 && !page->in_transit)
+    {
+        struct list_elem *clock = lru_list.lru_clock;
+        if (clock == &page->lru)
+            clock = list_next(clock);
+
+        list_remove(&page->lru);
+        if (clock == NULL || clock->next == NULL)
+            list_push_back(&lru_list.page_list, &page->lru);
+        else
+            list_insert(clock, &page->lru);
+        lru_list.lru_clock = &page->lru;
+        pagedir_set_accessed(pd, vaddr, false);
+        page->referenced = false;
+    }
+    lock_release(&lru_list.lru_list_lock);
+}
+
+/* Allocates a zeroed, large page aligned block of LARGE_PGCNT
+   user frames for the pages starting at user address UPAGE, which
+   must all have vm_entries.  Every frame gets a struct page of its
+   own, in transit, so that it can later be evicted by itself.
+   Returns the first of them, which the following LARGE_PGCNT - 1
+   pages succeed in the LRU list, or a null pointer if no aligned
+   block is free.  Never evicts. */
+struct page *alloc_large_page(uint8_t *upage)
+{
+    struct list pages;
+    size_t i;
+
+    uint8_t *kaddr = palloc_get_large(PAL_USER | PAL_ZERO);
+    if (kaddr == NULL)
+        return NULL;
+
+    list_init(&pages);
+    for (i = 0; i < LARGE_PGCNT; i++)
+    {
+        struct page *page = malloc(sizeof(struct page));
+        if (page == NULL)
+        {
+            while (!list_empty(&pages))
+                free(list_entry(list_pop_front(&pages), struct page, lru));
+            palloc_free_multiple(kaddr, LARGE_PGCNT);
+            return NULL;
+        }
+
+        page->kaddr = kaddr + i * PGSIZE;
+        page->vme = find_vme(upage + i * PGSIZE);
+        page->thread = thread_current();
+        page->pin_cnt = 0;
+        page->in_transit = true;
+        page->referenced = false;
+        page->share = NULL;
+        list_push_back(&pages, &page->lru);
+    }
+
+    lock_acquire(&lru_list.lru_list_lock);
+    struct page *first = list_entry(list_front(&pages), struct page, lru);
+    while (!list_empty(&pages))
+        lru_list_push_back(list_entry(list_pop_front(&pages), struct page, lru));
+    lock_release(&lru_list.lru_list_lock);
+
+    return first;
+}
+
+/* Like activate_page(), for the pages of a large page returned by
+   alloc_large_page(). */
+void activate_large_page(struct page *page)
+{
+    size_t i;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    for (i = 0; i < LARGE_PGCNT; i++)
+    {
+        page->in_transit = false;
+        page = list_entry(list_next(&page->lru), struct page, lru);
+    }
+    cond_broadcast(&lru_list.transit_cond, &lru_list.lru_list_lock);
+    lock_release(&lru_list.lru_list_lock);
+}
+
+/* Frees a large page returned by alloc_large_page() that could
+   not be mapped. */
+void free_large_page(struct page *page)
+{
+    void *kaddr = page->kaddr;
+    size_t i;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    for (i = 0; i < LARGE_PGCNT; i++)
+    {
+        struct page *next = list_entry(list_next(&page->lru), struct page, lru);
+        lru_list_remove(page);
+        free(page);
+        page = next;
+    }
+    palloc_free_multiple(kaddr, LARGE_PGCNT);
+    cond_broadcast(&lru_list.transit_cond, &lru_list.lru_list_lock);
+    lock_release(&lru_list.lru_list_lock);
+}
+
+/* Called once PAGE, from alloc_page(), has been filled and mapped
+   at its vm_entry's address.  Makes it evictable and, for
+   read-only executable pages, shares it with other processes. */
+void activate_page(struct page *page)
+{
+    lock_acquire(&lru_list.lru_list_lock);
+    page->in_transit = false;
+    if (vme_is_shareable(page->vme))
+        share_insert(page, page->vme);
+    cond_broadcast(&lru_list.transit_cond, &lru_list.lru_list_lock);
+    lock_release(&lru_list.lru_list_lock);
+}
 
+/* Returns true if page A should be written to swap before page B. */
+static bool swap_order_less(struct page *a, struct page *b)
+{
+    if (a->thread != b->thread)
+        return a->thread < b->thread;
+    return a->vme->vaddr < b->vme->vaddr;
+}
+
+/* Returns true if the page at KADDR holds only zeros. */
+static bool is_zero_page(const void *kaddr)
+{
+    const uint32_t *p = kaddr;
+    for (size_t i = 0; i < PGSIZE / sizeof *p; i++)
+        if (p[i] != 0)
+            return false;
+    return true;
+}
+
+/* Drops VICTIM without any I/O if it holds only zeros.  Its
+   vm_entry goes back to the zero-fill state. */
+static bool drop_zero_page(struct page *victim)
+{
+    if (!is_zero_page(victim->kaddr))
+        return false;
+
+    victim->vme->file = NULL;
+    victim->vme->sec_idx = SWAP_SLOT_NONE;
+    return true;
+}
+
+/* Tries to keep the contents of VICTIM in the compressed pool
+   instead of writing them to swap. */
+static bool store_compressed(struct page *victim)
+{
+    struct zswap_entry *entry = zswap_store(victim->kaddr);
+    if (entry == NULL)
+        return false;
+
+    victim->vme->zentry = entry;
+    victim->vme->sec_idx = SWAP_SLOT_NONE;
+    vmstat_count(victim->thread, VMC_ZSWAP_OUT, 1);
+    return true;
+}
+
+/* Returns the next frame to evict, skipping pages that would have
+   to go to swap while their owner already holds as many swap slots
+   as it may.  Such pages stay resident until the owner frees some.
+   Frames of processes above their fair share are preferred.
+   Stores whether the page is dirty in *IS_DIRTY.  Returns a null
+   pointer if no frame can be evicted.  Must be called with
+   lru_list_lock held. */
+static struct page *pick_victim(bool *is_dirty)
+{
+    /* Sparing only helps if someone else is above their share. */
+    bool spare = wss_any_over_share();
+    size_t tries;
+    for (tries = 0; tries < lru_list.page_cnt; tries++)
+    {
         struct page *victim = find_victim();
+        if (victim == NULL || victim->share != NULL)
+            return victim;
+
+        /* For the first half of the tries, spare processes that
+           hold no more than their share. */
+        if (spare && tries < lru_list.page_cnt / 2 && wss_within_share(victim->thread))
+            continue;
+
+        /* Frames of a large page go one by one. */
         struct vm_entry *vme = victim->vme;
-        struct thread *t = victim->thread;
-        bool is_dirty = pagedir_is_dirty(t->pagedir, victim->vme->vaddr);
+        uint32_t *pd = victim->thread->pagedir;
+        if (!pagedir_split_large_page(pd, vme->vaddr))
+            return NULL;
+
+        *is_dirty = pagedir_is_dirty(pd, vme->vaddr);
+        bool to_swap = vme->type == VM_ANON || (vme->type == VM_BIN && *is_dirty);
+        if (!to_swap || swap_charge(victim->thread))
+            return victim;
+    }
+    return NULL;
+}
+
+/* Evicts a cluster of pages chosen by pick_victim().  Pages that
+   have to go to swap are sorted by owner and virtual address and
+   written to one run of contiguous swap slots, so that neighbouring
+   virtual pages also end up next to each other on disk.  Pages
+   that are all zeros or compress well never reach the disk.
+
+   Victims are picked and unmapped under lru_list_lock, but written
+   out without it.  Meanwhile their vm_entries are in transit, and
+   an owner faulting on one waits in vme_wait_transit().  Returns
+   the number of frames freed.
+
+   If nothing can be evicted only because frames are in transit or
+   another eviction is still writing, waits for that I/O to finish
+   and sets *BUSY, so that the caller does not count the attempt as
+   a reclaim failure. */
+static size_t evict_pages(bool *busy)
+{
+    struct page *victims[SWAP_CLUSTER_MAX];
+    struct page *out_pages[SWAP_CLUSTER_MAX];
+    struct page *swap_pages[SWAP_CLUSTER_MAX];
+    struct page *file_pages[SWAP_CLUSTER_MAX];
+    void *swap_kaddrs[SWAP_CLUSTER_MAX];
+    size_t swap_sec_idxs[SWAP_CLUSTER_MAX];
+    size_t victim_cnt, out_cnt = 0, swap_cnt = 0, file_cnt = 0, zero_cnt = 0;
+    size_t i, j;
+
+    lock_acquire(&lru_list.lru_list_lock);
+
+    /* Take a bigger cluster only when there are plenty of frames. */
+    victim_cnt = lru_list.page_cnt / SWAP_CLUSTER_MAX;
+    if (victim_cnt < 1)
+        victim_cnt = 1;
+    else if (victim_cnt > SWAP_CLUSTER_MAX)
+        victim_cnt = SWAP_CLUSTER_MAX;
+
+    for (i = 0; i < victim_cnt; i++)
+    {
+        bool is_dirty = false;
+        struct page *victim = pick_victim(&is_dirty);
+        if (victim == NULL)
+            break;
+
+        victims[i] = victim;
+        lru_list_remove(victim);
+        vmstat_count(victim->thread, VMC_EVICT, 1);
+
+        /* Shared executable pages are clean, just unmap them. */
+        if (victim->share != NULL)
+        {
+            share_evict(victim);
+            continue;
+        }
+
+        struct vm_entry *vme = victim->vme;
+        uint32_t *pd = victim->thread->pagedir;
+
+        /* Unmap first so the owner cannot change the page while it
+           is being written out. */
+        pagedir_clear_page(pd, vme->vaddr);
 
         switch (vme->type)
         {
         case VM_BIN:
         {
             if (is_dirty)
-                vme->sec_idx = swap_out(victim->kaddr);
+                out_pages[out_cnt++] = victim;
             vme->type = VM_ANON;
             break;
         }
         case VM_FILE:
         {
             if (is_dirty)
-                file_write_at(vme->file, victim->kaddr, PGSIZE, vme->offset);
+                out_pages[out_cnt++] = victim;
             break;
         }
         case VM_ANON:
         {
-            vme->sec_idx = swap_out(victim->kaddr);
+            out_pages[out_cnt++] = victim;
             break;
         }
         default:
             break;
         }
+    }
+    victim_cnt = i;
 
-        free_page(victim);
-        pagedir_clear_page(t->pagedir, vme->vaddr);
-    } while (kaddr == NULL);
+    if (victim_cnt == 0)
+    {
+        *busy = lru_list.evict_cnt > 0 || transit_pending();
+        if (*busy)
+            cond_wait(&lru_list.transit_cond, &lru_list.lru_list_lock);
+        lock_release(&lru_list.lru_list_lock);
 
-    page->kaddr = kaddr;
-    page->thread = thread_current();
-    page->pinned = false;
-    lru_list_push_back(page);
+        /* Every frame is pinned or held back by a swap limit.  Let
+           their owners run. */
+        if (!*busy)
+            thread_yield();
+        return 0;
+    }
 
-    return page;
+    lru_list.evict_cnt++;
+    for (i = 0; i < out_cnt; i++)
+        out_pages[i]->vme->in_transit = true;
+    lock_release(&lru_list.lru_list_lock);
+
+    for (i = 0; i < out_cnt; i++)
+    {
+        struct page *victim = out_pages[i];
+        struct vm_entry *vme = victim->vme;
+
+        if (vme->type == VM_FILE)
+            file_pages[file_cnt++] = victim;
+        else
+        {
+            if (drop_zero_page(victim))
+                zero_cnt++;
+            else if (!store_compressed(victim))
+            {
+                swap_pages[swap_cnt++] = victim;
+                continue;
+            }
+            /* Charged by pick_victim(), but no slot was needed. */
+            swap_uncharge(victim->thread, 1);
+        }
+    }
+
+    if (file_cnt > 0)
+        writeback_cluster(file_pages, file_cnt);
+
+    if (swap_cnt > 0)
+    {
+        /* Insertion sort, the cluster is tiny. */
+        for (i = 1; i < swap_cnt; i++)
+        {
+            struct page *p = swap_pages[i];
+            for (j = i; j > 0 && swap_order_less(p, swap_pages[j - 1]); j--)
+                swap_pages[j] = swap_pages[j - 1];
+            swap_pages[j] = p;
+        }
+
+        for (i = 0; i < swap_cnt; i++)
+            swap_kaddrs[i] = swap_pages[i]->kaddr;
+        swap_out_cluster(swap_kaddrs, swap_sec_idxs, swap_cnt);
+        for (i = 0; i < swap_cnt; i++)
+            vmstat_count(swap_pages[i]->thread, VMC_SWAP_OUT, 1);
+    }
+
+    /* Free the frames before waking anyone waiting for them. */
+    for (i = 0; i < victim_cnt; i++)
+        palloc_free_page(victims[i]->kaddr);
+
+    lock_acquire(&lru_list.lru_list_lock);
+    for (i = 0; i < swap_cnt; i++)
+        swap_pages[i]->vme->sec_idx = swap_sec_idxs[i];
+    for (i = 0; i < out_cnt; i++)
+        out_pages[i]->vme->in_transit = false;
+    swap_partition.zero_drop_cnt += zero_cnt;
+    lru_list.evict_cnt--;
+    cond_broadcast(&lru_list.transit_cond, &lru_list.lru_list_lock);
+    lock_release(&lru_list.lru_list_lock);
+
+    for (i = 0; i < victim_cnt; i++)
+        free(victims[i]);
+    return victim_cnt;
+}
+
+/* Returns true if some frame is being filled or written back.
+   Must be called with lru_list_lock held. */
+static bool transit_pending(void)
+{
+    struct list_elem *e;
+
+    for (e = list_begin(&lru_list.page_list); e != list_end(&lru_list.page_list); e = list_next(e))
+        if (list_entry(e, struct page, lru)->in_transit)
+            return true;
+    return false;
 }
 
 struct page *find_page(void *kaddr)
@@ -94,13 +527,19 @@ struct page *find_page(void *kaddr)
 
 void free_page(struct page *page)
 {
+    lock_acquire(&lru_list.lru_list_lock);
     lru_list_remove(page);
     palloc_free_page(page->kaddr);
+
+    /* PAGE may have been in transit. */
+    cond_broadcast(&lru_list.transit_cond, &lru_list.lru_list_lock);
+    lock_release(&lru_list.lru_list_lock);
     free(page);
 }
 
 void free_thread_pages(struct thread *t)
 {
+    lock_acquire(&lru_list.lru_list_lock);
     struct page *p;
     struct list_elem *e = list_begin(&lru_list.page_list);
     while (e != list_end(&lru_list.page_list))
@@ -108,8 +547,13 @@ void free_thread_pages(struct thread *t)
         struct list_elem *tmp = list_next(e);
         p = list_entry(e, struct page, lru);
         if (p->thread == t)
-            free_page(p);
+        {
+            lru_list_remove(p);
+            palloc_free_page(p->kaddr);
+            free(p);
+        }
 
         e = tmp;
     }
+    lock_release(&lru_list.lru_list_lock);
 }
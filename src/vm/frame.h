@@ -5,11 +5,20 @@
 #include "threads/synch.h"
 #include "vm/page.h"
 
+/* Frame table.  LRU_LIST_LOCK protects the list, the clock hand,
+   the per-frame and per-entry in-transit flags and the share
+   table.  It is never held across disk I/O: frames being filled or
+   written out are marked in transit instead, and threads that need
+   such a page wait on TRANSIT_COND. */
 struct lru_list
 {
     struct list page_list;
     struct lock lru_list_lock;
+    struct condition transit_cond;
     struct list_elem *lru_clock;
+    size_t page_cnt;
+    size_t evict_cnt; /* evict_pages() calls writing victims out. */
+    void *zero_page; /* Shared read-only zero frame. */
 };
 
 struct lru_list lru_list;
@@ -19,6 +28,12 @@ void lru_list_push_back(struct page *page);
 void lru_list_remove(struct page *page);
 
 struct page *alloc_page(enum palloc_flags flags);
+struct page *try_alloc_page(enum palloc_flags flags);
+void activate_page(struct page *page);
+void deactivate_page(void *vaddr);
+struct page *alloc_large_page(uint8_t *upage);
+void activate_large_page(struct page *page);
+void free_large_page(struct page *page);
 struct page *find_page(void *kaddr);
 void free_page(struct page *page);
 void free_thread_pages(struct thread *t);
@@ -0,0 +1,93 @@
+#include "vm/oom.h"
+#include <debug.h>
+#include <list.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+#include "vm/vmstat.h"
+
+/* Out-of-memory killer.
+
+   When alloc_page() cannot evict anything OOM_RECLAIM_RETRIES times
+   in a row, every frame is pinned, in transit or held back by a
+   swap limit.  Then the process with the largest footprint, its
+   resident frames plus its swap slots, is chosen and marked.  A
+   process cannot be torn down from outside, so the victim exits
+   through exit() itself as soon as it next enters the kernel, by
+   a system call, a page fault or its own allocation.  Until it has
+   exited no other process is chosen, so that a victim slow to
+   enter the kernel does not take bystanders down with it. */
+
+static void find_pending(struct thread *t, void *aux);
+static void score_thread(struct thread *t, void *aux);
+
+/* Marks the process with the largest footprint that is not marked
+   yet for death, or the current process if there is none.  Does
+   nothing while an earlier victim is still alive. */
+void oom_kill(void)
+{
+    struct thread *victim = NULL;
+    struct list_elem *e;
+    bool pending = false;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    enum intr_level old_level = intr_disable();
+
+    thread_foreach(find_pending, &pending);
+    if (pending)
+    {
+        intr_set_level(old_level);
+        lock_release(&lru_list.lru_list_lock);
+        return;
+    }
+
+    thread_foreach(score_thread, NULL);
+    for (e = list_begin(&lru_list.page_list); e != list_end(&lru_list.page_list); e = list_next(e))
+    {
+        struct page *page = list_entry(e, struct page, lru);
+        if (page->thread != NULL)
+            page->thread->oom_score++;
+    }
+    thread_foreach(score_thread, &victim);
+
+    if (victim == NULL)
+        victim = thread_current();
+    victim->oom_killed = true;
+
+    intr_set_level(old_level);
+    lock_release(&lru_list.lru_list_lock);
+
+    vmstat_count(NULL, VMC_OOM_KILL, 1);
+}
+
+/* Returns true if the current process has been chosen by the OOM
+   killer and should exit. */
+bool oom_killed(void)
+{
+    return thread_current()->oom_killed;
+}
+
+/* Sets *AUX if T was chosen by the OOM killer but has not exited
+   yet. */
+static void find_pending(struct thread *t, void *aux)
+{
+    bool *pending = aux;
+
+    if (t->oom_killed && t->pagedir != NULL)
+        *pending = true;
+}
+
+/* With a null AUX, starts the score of user process T at the swap
+   slots it holds.  Otherwise makes T the victim in *AUX if it
+   scores higher and has not been chosen before. */
+static void score_thread(struct thread *t, void *aux)
+{
+    struct thread **victim = aux;
+
+    if (t->pagedir == NULL)
+        return;
+    if (victim == NULL)
+        t->oom_score = t->vmstat.counters[VMC_SWAP_SLOTS];
+    else if (!t->oom_killed && (*victim == NULL || t->oom_score > (*victim)->oom_score))
+        *victim = t;
+}
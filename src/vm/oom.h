@@ -0,0 +1,13 @@
+#ifndef VM_OOM_H
+#define VM_OOM_H
+
+#include <stdbool.h>
+
+/* Failed eviction attempts in a row before memory counts as
+   exhausted. */
+#define OOM_RECLAIM_RETRIES 8
+
+void oom_kill(void);
+bool oom_killed(void);
+
+#endif
@@ -1,9 +1,9 @@
 #ifndef VM_PAGE_H
 #define VM_PAGE_H
 
-#include <hash.h>
 #include "filesys/file.h"
 #include "threads/thread.h"
+#include "vm/zswap.h"
 
 enum vm_type
 {
@@ -12,15 +12,23 @@ enum vm_type
     VM_ANON
 };
 
+struct share_entry;
+
 struct page
 {
     uint8_t *kaddr;
     struct vm_entry *vme;
     struct thread *thread;
     struct list_elem lru;
-    bool pinned;
+    int pin_cnt;               /* Pins held, see check_valid_buffer(). */
+    bool in_transit;           /* Being filled, not yet evictable. */
+    bool referenced;           /* Accessed bit saved by vm/wss.c. */
+    struct share_entry *share; /* Non-null if shared between processes. */
 };
 
+/* Value of vm_entry's SEC_IDX while it holds no swap slot. */
+#define SWAP_SLOT_NONE ((size_t)-1)
+
 struct vm_entry
 {
     uint8_t *vaddr;
@@ -30,29 +38,27 @@ struct vm_entry
     struct file *file;
     bool writable;
     enum vm_type type;
-    size_t sec_idx;
-
-    struct hash_elem elem;
-    struct list_elem mmap_elem;
+    size_t sec_idx; /* Swap slot, or SWAP_SLOT_NONE. */
+    struct zswap_entry *zentry; /* Compressed copy, if any. */
+    bool in_transit;            /* Being written out by an evictor. */
 };
 
-struct mmap_file
+/* Inline room of a pin_set, enough for most system calls. */
+#define PIN_SET_INLINE 8
+
+/* Frames pinned by one check_valid_buffer() call. */
+struct pin_set
 {
-    int mapid;
-    struct file *file;
-    struct list_elem elem;
-    struct list vme_list;
+    struct page **pages; /* INLINE_PAGES, or an array from malloc(). */
+    size_t cnt;
+    struct page *inline_pages[PIN_SET_INLINE];
 };
 
-void vm_init(struct hash *vm);
-void vm_destory(struct hash *vm);
-struct vm_entry *find_vme(void *vaddr);
-bool insert_vme(struct hash *vm, struct vm_entry *vme);
-bool delete_vme(struct hash *vm, struct vm_entry *vme);
 bool load_file(void *kpage, struct vm_entry *vme);
+bool vme_is_zero_fill(struct vm_entry *vme);
+void vme_wait_transit(struct vm_entry *vme);
 struct vm_entry *check_address(void *vaddr);
-void check_valid_buffer(void *buffer, unsigned size);
-void mmunmap_file(struct mmap_file *mmap_file);
-void unpin_page(void);
+void check_valid_buffer(void *buffer, unsigned size, struct pin_set *pins);
+void unpin_buffer(struct pin_set *pins);
 
 #endif
\ No newline at end of file
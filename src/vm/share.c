@@ -0,0 +1,206 @@
+#include "vm/share.h"
+#include <stdio.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+
+/* Read-only executable pages currently in memory. */
+static struct hash share_table;
+
+/* Statistics. */
+static unsigned long long share_hit_cnt;  /* Faults served from the table. */
+static unsigned long long share_miss_cnt; /* Pages read in and added. */
+
+static unsigned share_hash_func(const struct hash_elem *e, void *aux UNUSED);
+static bool share_less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED);
+static struct share_mapping *find_mapping(struct share_entry *entry, struct thread *t);
+
+void share_init(void)
+{
+    hash_init(&share_table, share_hash_func, share_less_func, NULL);
+}
+
+/* Returns true if VME may share its frame with other processes. */
+bool vme_is_shareable(struct vm_entry *vme)
+{
+    return vme->type == VM_BIN && !vme->writable && vme->file != NULL;
+}
+
+/* Returns the frame already holding VME's page, or a null pointer
+   if no process has it in memory. */
+struct page *share_lookup(struct vm_entry *vme)
+{
+    struct share_entry key;
+    struct hash_elem *e;
+
+    key.sector = inode_get_inumber(file_get_inode(vme->file));
+    key.offset = vme->offset;
+    key.read_bytes = vme->read_bytes;
+    e = hash_find(&share_table, &key.elem);
+    return e != NULL ? hash_entry(e, struct share_entry, elem)->page : NULL;
+}
+
+/* Publishes PAGE, just read in for VME by the current thread, so
+   that other processes can map it.  PAGE must already be mapped at
+   VME's address.  Returns false if memory runs out, in which case
+   PAGE stays private. */
+bool share_insert(struct page *page, struct vm_entry *vme)
+{
+    struct share_entry *entry = malloc(sizeof *entry);
+    struct share_mapping *m = malloc(sizeof *m);
+    if (entry == NULL || m == NULL)
+    {
+        free(entry);
+        free(m);
+        return false;
+    }
+
+    entry->sector = inode_get_inumber(file_get_inode(vme->file));
+    entry->offset = vme->offset;
+    entry->read_bytes = vme->read_bytes;
+    entry->page = page;
+    list_init(&entry->mappings);
+    if (hash_insert(&share_table, &entry->elem) != NULL)
+    {
+        free(entry);
+        free(m);
+        return false;
+    }
+
+    m->thread = page->thread;
+    m->vme = vme;
+    list_push_back(&entry->mappings, &m->elem);
+
+    /* Shared frames belong to no single thread. */
+    page->share = entry;
+    page->thread = NULL;
+    page->vme = NULL;
+    share_miss_cnt++;
+    return true;
+}
+
+/* Maps shared PAGE read-only at VME's address in the current
+   thread. */
+bool share_map(struct page *page, struct vm_entry *vme)
+{
+    struct thread *cur = thread_current();
+    struct share_mapping *m = malloc(sizeof *m);
+    if (m == NULL)
+        return false;
+
+    if (pagedir_get_page(cur->pagedir, vme->vaddr) != NULL || !pagedir_set_page(cur->pagedir, vme->vaddr, page->kaddr, false))
+    {
+        free(m);
+        return false;
+    }
+
+    m->thread = cur;
+    m->vme = vme;
+    list_push_back(&page->share->mappings, &m->elem);
+    share_hit_cnt++;
+    return true;
+}
+
+/* Removes T's mapping of shared PAGE.  Returns true if that was
+   the last mapping, in which case PAGE is dropped from the table
+   and the caller must free it. */
+bool share_unmap(struct page *page, struct thread *t)
+{
+    struct share_entry *entry = page->share;
+    struct share_mapping *m = find_mapping(entry, t);
+    if (m != NULL)
+    {
+        pagedir_clear_page(t->pagedir, m->vme->vaddr);
+        list_remove(&m->elem);
+        free(m);
+    }
+
+    if (!list_empty(&entry->mappings))
+        return false;
+
+    hash_delete(&share_table, &entry->elem);
+    free(entry);
+    page->share = NULL;
+    return true;
+}
+
+/* Unmaps shared PAGE from every process and drops it from the
+   table.  The pages are read-only, so nothing is written back. */
+void share_evict(struct page *page)
+{
+    struct share_entry *entry = page->share;
+    while (!list_empty(&entry->mappings))
+    {
+        struct share_mapping *m = list_entry(list_pop_front(&entry->mappings), struct share_mapping, elem);
+        pagedir_clear_page(m->thread->pagedir, m->vme->vaddr);
+        free(m);
+    }
+
+    hash_delete(&share_table, &entry->elem);
+    free(entry);
+    page->share = NULL;
+}
+
+/* Returns true if any process accessed shared PAGE recently. */
+bool share_is_accessed(struct page *page)
+{
+    struct list_elem *e;
+    for (e = list_begin(&page->share->mappings); e != list_end(&page->share->mappings); e = list_next(e))
+    {
+        struct share_mapping *m = list_entry(e, struct share_mapping, elem);
+        if (pagedir_is_accessed(m->thread->pagedir, m->vme->vaddr))
+            return true;
+    }
+    return false;
+}
+
+/* Clears the accessed bit of shared PAGE in every process. */
+void share_clear_accessed(struct page *page)
+{
+    struct list_elem *e;
+    for (e = list_begin(&page->share->mappings); e != list_end(&page->share->mappings); e = list_next(e))
+    {
+        struct share_mapping *m = list_entry(e, struct share_mapping, elem);
+        pagedir_set_accessed(m->thread->pagedir, m->vme->vaddr, false);
+    }
+}
+
+/* Prints how many executable page faults were served by sharing. */
+void share_print_stats(void)
+{
+    printf("Share: %llu faults served from shared pages, %llu pages read in, %zu resident\n",
+           share_hit_cnt, share_miss_cnt, hash_size(&share_table));
+}
+
+static struct share_mapping *find_mapping(struct share_entry *entry, struct thread *t)
+{
+    struct list_elem *e;
+    for (e = list_begin(&entry->mappings); e != list_end(&entry->mappings); e = list_next(e))
+    {
+        struct share_mapping *m = list_entry(e, struct share_mapping, elem);
+        if (m->thread == t)
+            return m;
+    }
+    return NULL;
+}
+
+static unsigned share_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+    struct share_entry *entry = hash_entry(e, struct share_entry, elem);
+    return hash_int(entry->sector) ^ hash_int(entry->offset) ^ hash_int(entry->read_bytes);
+}
+
+static bool share_less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+    struct share_entry *entry_a = hash_entry(a, struct share_entry, elem);
+    struct share_entry *entry_b = hash_entry(b, struct share_entry, elem);
+
+    if (entry_a->sector != entry_b->sector)
+        return entry_a->sector < entry_b->sector;
+    if (entry_a->offset != entry_b->offset)
+        return entry_a->offset < entry_b->offset;
+    return entry_a->read_bytes < entry_b->read_bytes;
+}
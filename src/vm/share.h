@@ -0,0 +1,44 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <hash.h>
+#include <list.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+#include "vm/page.h"
+
+/* A read-only executable page shared by every process that maps
+   it, keyed by the executable's inode sector, the page's file
+   offset and how many bytes of it come from the file.  Segments
+   that meet within a page zero-fill it differently, so READ_BYTES
+   keeps them apart.  Protected by lru_list_lock. */
+struct share_entry
+{
+    block_sector_t sector; /* Inode sector of the executable. */
+    off_t offset;          /* Offset of the page in the executable. */
+    size_t read_bytes;     /* Bytes read from the file, zeros after. */
+    struct page *page;     /* Frame holding the page. */
+    struct list mappings;  /* List of struct share_mapping. */
+    struct hash_elem elem;
+};
+
+/* One process mapping a shared page. */
+struct share_mapping
+{
+    struct thread *thread;
+    struct vm_entry *vme;
+    struct list_elem elem;
+};
+
+void share_init(void);
+bool vme_is_shareable(struct vm_entry *vme);
+struct page *share_lookup(struct vm_entry *vme);
+bool share_insert(struct page *page, struct vm_entry *vme);
+bool share_map(struct page *page, struct vm_entry *vme);
+bool share_unmap(struct page *page, struct thread *t);
+void share_evict(struct page *page);
+bool share_is_accessed(struct page *page);
+void share_clear_accessed(struct page *page);
+void share_print_stats(void);
+
+#endif
@@ -1,62 +1,188 @@
 #include "vm/swap.h"
+#include <stdio.h>
 #include "devices/block.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/share.h"
+#include "vm/vmstat.h"
 
+static struct lock_class swap_lock_class = LOCK_CLASS_INITIALIZER("swap", 0);
+
+/* Runs the clock over the LRU list and returns the first frame
+   that was not accessed since the last pass and is neither pinned
+   nor in transit.  An access the working set sampler moved into
+   the frame's REFERENCED flag counts as well.  Gives up and
+   returns a null pointer after two full passes.  Must be called
+   with lru_list_lock held. */
 struct page *find_victim()
 {
+    if (list_empty(&lru_list.page_list))
+        return NULL;
+
     struct list_elem *clock = lru_list.lru_clock;
     if (clock == NULL || clock->next == NULL)
         clock = list_begin(&lru_list.page_list);
 
-    struct page *p;
-    while (true)
+    struct page *p, *victim = NULL;
+    size_t budget = 2 * lru_list.page_cnt;
+    while (budget > 0 && victim == NULL)
     {
         if (clock == list_end(&lru_list.page_list))
+        {
             clock = list_begin(&lru_list.page_list);
+            continue;
+        }
+        budget--;
 
         p = list_entry(clock, struct page, lru);
-        bool is_accessed = pagedir_is_accessed(p->thread->pagedir, p->vme->vaddr);
+        if (p->in_transit)
+        {
+            clock = list_next(clock);
+            continue;
+        }
+
+        if (p->share != NULL)
+        {
+            /* Referenced if any sharer touched it. */
+            if (share_is_accessed(p))
+                share_clear_accessed(p);
+            else if (p->pin_cnt == 0)
+                victim = p;
+            clock = list_next(clock);
+            continue;
+        }
+
+        bool is_accessed = p->referenced || pagedir_is_accessed(p->thread->pagedir, p->vme->vaddr);
         if (is_accessed)
-            pagedir_set_accessed(p->thread->pagedir, p->vme->vaddr, !is_accessed);
-        else
         {
-            if (!p->pinned)
-            {
-                lru_list.lru_clock = list_next(clock);
-                return p;
-            }
+            pagedir_set_accessed(p->thread->pagedir, p->vme->vaddr, !is_accessed);
+            p->referenced = false;
         }
+        else if (p->pin_cnt == 0)
+            victim = p;
         clock = list_next(clock);
     }
+
+    lru_list.lru_clock = clock;
+    vmstat_count(thread_current(), VMC_SCAN, 2 * lru_list.page_cnt - budget);
+    return victim;
 }
 
-void swap_bitmap_init()
+/* Sets up the swap partition.  Each process may hold at most
+   PROC_LIMIT swap slots at a time. */
+void swap_bitmap_init(size_t proc_limit)
 {
     size_t sec_size = block_size(block_get_role(BLOCK_SWAP)) * BLOCK_SECTOR_SIZE / PGSIZE;
     swap_partition.bitmap = bitmap_create(sec_size);
-    lock_init(&swap_partition.swap_lock);
+    lock_init_class(&swap_partition.swap_lock, &swap_lock_class);
+    swap_partition.cursor = 0;
+    swap_partition.proc_limit = proc_limit;
+    swap_partition.swap_in_cnt = 0;
+    swap_partition.swap_out_cnt = 0;
+    swap_partition.zero_drop_cnt = 0;
 }
 
-size_t swap_out(void *kaddr)
+/* Allocates CNT contiguous swap slots, starting the search at the
+   allocation cursor and wrapping around once.  Returns the first
+   slot, or BITMAP_ERROR if no such run is free. */
+static size_t swap_alloc(size_t cnt)
 {
     struct bitmap *swap_bitmap = swap_partition.bitmap;
-    struct block *swap_block = block_get_role(BLOCK_SWAP);
-    size_t sec_idx = bitmap_scan_and_flip(swap_bitmap, 0, 1, false);
+    size_t sec_idx = bitmap_scan_and_flip(swap_bitmap, swap_partition.cursor, cnt, false);
+    if (sec_idx == BITMAP_ERROR && swap_partition.cursor != 0)
+        sec_idx = bitmap_scan_and_flip(swap_bitmap, 0, cnt, false);
 
-    for (size_t i = 0; i < 8; i++)
-        block_write(swap_block, sec_idx * 8 + i, kaddr + BLOCK_SECTOR_SIZE * i);
+    if (sec_idx != BITMAP_ERROR)
+        swap_partition.cursor = (sec_idx + cnt) % bitmap_size(swap_bitmap);
     return sec_idx;
 }
 
+/* Writes the CNT pages in KADDRS to swap and stores the slot of
+   each page in SEC_IDXS.  The pages are given one run of
+   contiguous slots when possible, so the whole cluster goes out
+   as a single ascending sector sequence. */
+void swap_out_cluster(void **kaddrs, size_t *sec_idxs, size_t cnt)
+{
+    struct block *swap_block = block_get_role(BLOCK_SWAP);
+
+    lock_acquire(&swap_partition.swap_lock);
+    size_t sec_idx = swap_alloc(cnt);
+    for (size_t i = 0; i < cnt; i++)
+    {
+        if (sec_idx != BITMAP_ERROR)
+            sec_idxs[i] = sec_idx + i;
+        else
+        {
+            /* Fragmented swap, fall back to one slot at a time. */
+            sec_idxs[i] = swap_alloc(1);
+            if (sec_idxs[i] == BITMAP_ERROR)
+                PANIC("swap partition is full");
+        }
+    }
+    swap_partition.swap_out_cnt += cnt;
+    lock_release(&swap_partition.swap_lock);
+
+    for (size_t i = 0; i < cnt; i++)
+        for (size_t j = 0; j < SWAP_SLOT_SECTORS; j++)
+            block_write(swap_block, sec_idxs[i] * SWAP_SLOT_SECTORS + j, kaddrs[i] + BLOCK_SECTOR_SIZE * j);
+}
+
 void swap_in(size_t sec_idx, void *kaddr)
 {
     struct bitmap *swap_bitmap = swap_partition.bitmap;
     struct block *swap_block = block_get_role(BLOCK_SWAP);
 
-    for (size_t i = 0; i < 8; i++)
-        block_read(swap_block, sec_idx * 8 + i, kaddr + BLOCK_SECTOR_SIZE * i);
+    for (size_t i = 0; i < SWAP_SLOT_SECTORS; i++)
+        block_read(swap_block, sec_idx * SWAP_SLOT_SECTORS + i, kaddr + BLOCK_SECTOR_SIZE * i);
+
+    lock_acquire(&swap_partition.swap_lock);
     bitmap_set(swap_bitmap, sec_idx, false);
+    swap_partition.swap_in_cnt++;
+    lock_release(&swap_partition.swap_lock);
+
+    vmstat_count(thread_current(), VMC_SWAP_IN, 1);
+    swap_uncharge(thread_current(), 1);
+}
+
+/* Charges one swap slot to T before one of its pages is chosen to
+   be swapped out.  Returns false, charging nothing, if T already
+   holds as many slots as one process may or every slot is taken,
+   counting those charged but not yet written. */
+bool swap_charge(struct thread *t)
+{
+    if (vmstat_get(t, VMC_SWAP_SLOTS) >= swap_partition.proc_limit)
+        return false;
+    if (vmstat_get(NULL, VMC_SWAP_SLOTS) >= bitmap_size(swap_partition.bitmap))
+        return false;
+    vmstat_count(t, VMC_SWAP_SLOTS, 1);
+    return true;
+}
+
+/* Returns CNT slots charged to T, either freed or never used
+   because the page did not need the disk after all. */
+void swap_uncharge(struct thread *t, size_t cnt)
+{
+    vmstat_uncount(t, VMC_SWAP_SLOTS, cnt);
+}
+
+/* Frees the CNT swap slots in SEC_IDXS, which hold pages of T that
+   will never be read back, taking swap_lock only once. */
+void swap_free_slots(struct thread *t, const size_t *sec_idxs, size_t cnt)
+{
+    lock_acquire(&swap_partition.swap_lock);
+    for (size_t i = 0; i < cnt; i++)
+        bitmap_set(swap_partition.bitmap, sec_idxs[i], false);
+    lock_release(&swap_partition.swap_lock);
+
+    swap_uncharge(t, cnt);
+}
+
+/* Prints swap device statistics. */
+void swap_print_stats(void)
+{
+    printf("Swap: %llu pages out, %llu pages in, %llu zero pages dropped, %zu slots in use\n",
+           swap_partition.swap_out_cnt, swap_partition.swap_in_cnt,
+           swap_partition.zero_drop_cnt, bitmap_count(swap_partition.bitmap, 0, bitmap_size(swap_partition.bitmap), true));
 }
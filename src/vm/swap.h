@@ -2,19 +2,37 @@
 #define VM_SWAP_H
 
 #include <bitmap.h>
+#include "devices/block.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "vm/page.h"
 
+/* Number of sectors in one swap slot. */
+#define SWAP_SLOT_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Maximum number of pages evicted together. */
+#define SWAP_CLUSTER_MAX 8
+
 struct swap_partition
 {
     struct bitmap *bitmap;
     struct lock swap_lock;
+    size_t cursor;     /* Next slot to try, rotates over the partition. */
+    size_t proc_limit; /* Slots one process may hold. */
+    unsigned long long swap_in_cnt;
+    unsigned long long swap_out_cnt;
+    unsigned long long zero_drop_cnt; /* Zero pages evicted without I/O. */
 };
 
 struct swap_partition swap_partition;
 
 struct page *find_victim();
-void swap_bitmap_init();
-size_t swap_out(void *kaddr);
+void swap_bitmap_init(size_t proc_limit);
+void swap_out_cluster(void **kaddrs, size_t *sec_idxs, size_t cnt);
 void swap_in(size_t sec_idx, void *kaddr);
+bool swap_charge(struct thread *t);
+void swap_uncharge(struct thread *t, size_t cnt);
+void swap_free_slots(struct thread *t, const size_t *sec_idxs, size_t cnt);
+void swap_print_stats(void);
 
-#endif
\ No newline at end of file
+#endif
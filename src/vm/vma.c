@@ -0,0 +1,410 @@
+#include "vm/vma.h"
+#include <round.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/writeback.h"
+
+/* Swap slots of an exiting process, freed a batch at a time. */
+struct slot_batch
+{
+    size_t sec_idxs[64];
+    size_t cnt;
+};
+
+static struct vma *floor_vma(struct vma *root, const void *vaddr);
+static struct vma *tree_insert(struct vma *root, struct vma *vma);
+static struct vma *tree_remove(struct vma *root, struct vma *vma);
+static void tree_destroy(struct vma *root, struct slot_batch *batch);
+static void vma_for_each(struct vma *vma, void (*func)(struct vm_entry *, void *), void *aux);
+static struct vm_entry *vma_entry(struct vma *vma, void *vaddr);
+static void vma_free(struct vma *vma);
+static void destroy_entry(struct vm_entry *vme, void *batch);
+static void unmap_entry(struct vm_entry *vme, void *aux);
+
+void vm_init(struct vma **vm)
+{
+    *vm = NULL;
+}
+
+/* Frees every region of the current process along with the frames
+   and swap slots still holding its pages. */
+void vm_destory(struct vma **vm)
+{
+    struct slot_batch batch;
+    batch.cnt = 0;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    tree_destroy(*vm, &batch);
+    lock_release(&lru_list.lru_list_lock);
+    swap_free_slots(thread_current(), batch.sec_idxs, batch.cnt);
+    *vm = NULL;
+}
+
+/* Adds pages [START, END) to the current process, backed by the
+   READ_BYTES bytes of FILE from OFFSET and zeros after them.
+   Returns the new region, or a null pointer if it would overlap
+   another region or memory runs out. */
+struct vma *vma_create(void *start, void *end, enum vm_type type, struct file *file,
+                       off_t offset, size_t read_bytes, bool writable)
+{
+    ASSERT(pg_ofs(start) == 0 && pg_ofs(end) == 0);
+    ASSERT(start < end);
+
+    if (vma_overlaps(start, end))
+        return NULL;
+
+    struct vma *vma = malloc(sizeof(struct vma));
+    if (vma == NULL)
+        return NULL;
+
+    vma->chunk_cnt = DIV_ROUND_UP(pg_no(end) - pg_no(start), VMA_CHUNK_PAGES);
+    vma->chunks = calloc(vma->chunk_cnt, sizeof *vma->chunks);
+    if (vma->chunks == NULL)
+    {
+        free(vma);
+        return NULL;
+    }
+
+    vma->base = vma->start = start;
+    vma->end = end;
+    vma->type = type;
+    vma->file = file;
+    vma->offset = offset;
+    vma->read_bytes = read_bytes;
+    vma->writable = writable;
+    vma->mapid = -1;
+    vma->advice = MADV_NORMAL;
+
+    struct thread *cur = thread_current();
+    cur->vm = tree_insert(cur->vm, vma);
+    return vma;
+}
+
+/* Returns the current process's region whose reservation covers
+   VADDR, or a null pointer if there is none. */
+struct vma *find_vma(const void *vaddr)
+{
+    struct vma *vma = floor_vma(thread_current()->vm, vaddr);
+    return vma != NULL && (const uint8_t *)vaddr < vma->end ? vma : NULL;
+}
+
+/* Returns true if any region of the current process reserves a
+   page of [START, END). */
+bool vma_overlaps(const void *start, const void *end)
+{
+    struct vma *vma = floor_vma(thread_current()->vm, (const uint8_t *)end - 1);
+    return vma != NULL && vma->end > (const uint8_t *)start;
+}
+
+/* Returns the vm_entry of the page at VADDR, or a null pointer if
+   VADDR is not in a valid part of a region or memory runs out. */
+struct vm_entry *find_vme(void *vaddr)
+{
+    struct vma *vma = find_vma(vaddr);
+    if (vma == NULL || (uint8_t *)vaddr < vma->start)
+        return NULL;
+    return vma_entry(vma, vaddr);
+}
+
+/* Writes the dirty pages of file mapping VMA back, frees its frames
+   and removes it from the current process. */
+void mmunmap_file(struct vma *vma)
+{
+    struct thread *cur = thread_current();
+
+    /* Write back in clusters first; unmap_entry() then finds the
+       pages clean. */
+    writeback_dirty(cur, vma->start, vma->end);
+    vma_for_each(vma, unmap_entry, NULL);
+    cur->vm = tree_remove(cur->vm, vma);
+    vma_free(vma);
+}
+
+/* Returns the region of tree ROOT with the greatest base not above
+   VADDR. */
+static struct vma *floor_vma(struct vma *root, const void *vaddr)
+{
+    struct vma *floor = NULL;
+    while (root != NULL)
+    {
+        if (root->base <= (const uint8_t *)vaddr)
+        {
+            floor = root;
+            root = root->right;
+        }
+        else
+            root = root->left;
+    }
+    return floor;
+}
+
+static int height(struct vma *node)
+{
+    return node != NULL ? node->height : 0;
+}
+
+static void update_height(struct vma *node)
+{
+    int left = height(node->left), right = height(node->right);
+    node->height = (left > right ? left : right) + 1;
+}
+
+static struct vma *rotate_right(struct vma *node)
+{
+    struct vma *left = node->left;
+    node->left = left->right;
+    left->right = node;
+    update_height(node);
+    update_height(left);
+    return left;
+}
+
+static struct vma *rotate_left(struct vma *node)
+{
+    struct vma *right = node->right;
+    node->right = right->left;
+    right->left = node;
+    update_height(node);
+    update_height(right);
+    return right;
+}
+
+/* Recomputes NODE's height, rotating it if its subtrees differ in
+   height by more than one.  Returns the new root of the subtree. */
+static struct vma *rebalance(struct vma *node)
+{
+    int balance = height(node->left) - height(node->right);
+    if (balance > 1)
+    {
+        if (height(node->left->left) < height(node->left->right))
+            node->left = rotate_left(node->left);
+        return rotate_right(node);
+    }
+    if (balance < -1)
+    {
+        if (height(node->right->right) < height(node->right->left))
+            node->right = rotate_right(node->right);
+        return rotate_left(node);
+    }
+
+    update_height(node);
+    return node;
+}
+
+static struct vma *tree_insert(struct vma *root, struct vma *vma)
+{
+    if (root == NULL)
+    {
+        vma->left = vma->right = NULL;
+        vma->height = 1;
+        return vma;
+    }
+
+    if (vma->base < root->base)
+        root->left = tree_insert(root->left, vma);
+    else
+        root->right = tree_insert(root->right, vma);
+    return rebalance(root);
+}
+
+/* Unlinks the leftmost region of ROOT into *MIN. */
+static struct vma *tree_remove_min(struct vma *root, struct vma **min)
+{
+    if (root->left == NULL)
+    {
+        *min = root;
+        return root->right;
+    }
+    root->left = tree_remove_min(root->left, min);
+    return rebalance(root);
+}
+
+static struct vma *tree_remove(struct vma *root, struct vma *vma)
+{
+    if (root == NULL)
+        return NULL;
+
+    if (vma->base < root->base)
+        root->left = tree_remove(root->left, vma);
+    else if (vma->base > root->base)
+        root->right = tree_remove(root->right, vma);
+    else
+    {
+        struct vma *min, *right;
+        if (root->right == NULL)
+            return root->left;
+
+        right = tree_remove_min(root->right, &min);
+        min->left = root->left;
+        min->right = right;
+        return rebalance(min);
+    }
+    return rebalance(root);
+}
+
+/* Frees tree ROOT.  Must be called with lru_list_lock held. */
+static void tree_destroy(struct vma *root, struct slot_batch *batch)
+{
+    if (root == NULL)
+        return;
+
+    tree_destroy(root->left, batch);
+    tree_destroy(root->right, batch);
+    vma_for_each(root, destroy_entry, batch);
+    vma_free(root);
+}
+
+/* Calls FUNC with AUX on every vm_entry of VMA that has been
+   looked up. */
+static void vma_for_each(struct vma *vma, void (*func)(struct vm_entry *, void *), void *aux)
+{
+    size_t c, i;
+    for (c = 0; c < vma->chunk_cnt; c++)
+    {
+        if (vma->chunks[c] == NULL)
+            continue;
+
+        for (i = 0; i < VMA_CHUNK_PAGES; i++)
+        {
+            struct vm_entry *vme = &vma->chunks[c][i];
+            if (vme->vaddr >= vma->start && vme->vaddr < vma->end)
+                func(vme, aux);
+        }
+    }
+}
+
+/* Returns the vm_entry of the page at VADDR in VMA, filling in its
+   chunk from the region's attributes on the first lookup there.
+   Returns a null pointer if memory runs out. */
+static struct vm_entry *vma_entry(struct vma *vma, void *vaddr)
+{
+    size_t idx = pg_no(vaddr) - pg_no(vma->base);
+    struct vm_entry **chunk = &vma->chunks[idx / VMA_CHUNK_PAGES];
+
+    if (*chunk == NULL)
+    {
+        size_t first = idx - idx % VMA_CHUNK_PAGES;
+        size_t i;
+
+        *chunk = palloc_get_page(0);
+        if (*chunk == NULL)
+            return NULL;
+
+        for (i = 0; i < VMA_CHUNK_PAGES; i++)
+        {
+            struct vm_entry *vme = &(*chunk)[i];
+            size_t pos = (first + i) * PGSIZE;
+            size_t read_bytes = pos < vma->read_bytes ? vma->read_bytes - pos : 0;
+
+            vme->vaddr = vma->base + pos;
+            vme->read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+            vme->zero_bytes = PGSIZE - vme->read_bytes;
+            vme->offset = vma->offset + pos;
+            vme->file = vma->file;
+            vme->writable = vma->writable;
+            vme->type = vma->type;
+            vme->sec_idx = SWAP_SLOT_NONE;
+            vme->zentry = NULL;
+            vme->in_transit = false;
+        }
+    }
+
+    return &(*chunk)[idx % VMA_CHUNK_PAGES];
+}
+
+static void vma_free(struct vma *vma)
+{
+    size_t c;
+    for (c = 0; c < vma->chunk_cnt; c++)
+        if (vma->chunks[c] != NULL)
+            palloc_free_page(vma->chunks[c]);
+    free(vma->chunks);
+    free(vma);
+}
+
+/* Takes VME's frame off the LRU list at exit and adds its swap
+   slot, if any, to slot_batch BATCH.  The frame itself is freed by
+   pagedir_destroy(). */
+static void destroy_entry(struct vm_entry *vme, void *batch_)
+{
+    struct slot_batch *batch = batch_;
+    struct thread *cur = thread_current();
+    vme_wait_transit(vme);
+
+    void *kaddr = pagedir_get_page(cur->pagedir, vme->vaddr);
+    if (kaddr == lru_list.zero_page)
+    {
+        /* Not ours to free in pagedir_destroy(). */
+        pagedir_clear_page(cur->pagedir, vme->vaddr);
+    }
+    else if (kaddr != NULL)
+    {
+        struct page *page = find_page(kaddr);
+        if (page != NULL && page->share != NULL)
+        {
+            /* Frame outlives us unless we were the last sharer. */
+            if (share_unmap(page, cur))
+            {
+                lru_list_remove(page);
+                palloc_free_page(page->kaddr);
+                free(page);
+            }
+        }
+        else if (page != NULL)
+        {
+            lru_list_remove(page);
+            free(page);
+        }
+    }
+    if (vme->zentry != NULL)
+        zswap_free(vme->zentry);
+
+    if (vme->sec_idx != SWAP_SLOT_NONE)
+    {
+        if (batch->cnt == sizeof batch->sec_idxs / sizeof *batch->sec_idxs)
+        {
+            swap_free_slots(cur, batch->sec_idxs, batch->cnt);
+            batch->cnt = 0;
+        }
+        batch->sec_idxs[batch->cnt++] = vme->sec_idx;
+        vme->sec_idx = SWAP_SLOT_NONE;
+    }
+}
+
+/* Unmaps file-mapped page VME, writing it back if dirty. */
+static void unmap_entry(struct vm_entry *vme, void *aux UNUSED)
+{
+    struct thread *cur = thread_current();
+
+    /* Take the frame off the LRU list, then write it back without
+       holding the lock. */
+    lock_acquire(&lru_list.lru_list_lock);
+    vme_wait_transit(vme);
+
+    struct page *page = NULL;
+    bool is_dirty = false;
+    void *kaddr = pagedir_get_page(cur->pagedir, vme->vaddr);
+    if (kaddr != NULL)
+    {
+        is_dirty = pagedir_is_dirty(cur->pagedir, vme->vaddr);
+        page = find_page(kaddr);
+        if (page != NULL)
+            lru_list_remove(page);
+    }
+
+    pagedir_clear_page(cur->pagedir, vme->vaddr);
+    lock_release(&lru_list.lru_list_lock);
+
+    if (page != NULL)
+    {
+        if (is_dirty)
+            file_write_at(vme->file, kaddr, vme->read_bytes, vme->offset);
+        palloc_free_page(kaddr);
+        free(page);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/file.h"
+#include "filesys/off_t.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* mmap() flags, madvise() advice and msync() flags, as in
+   lib/user/syscall.h. */
+#define MAP_POPULATE 0x1
+#define MADV_NORMAL 0
+#define MADV_RANDOM 1
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
+#define MADV_DONTNEED 4
+#define MS_ASYNC 1
+#define MS_SYNC 4
+
+/* Number of vm_entries in one chunk of a region's per-page state. */
+#define VMA_CHUNK_PAGES (PGSIZE / sizeof(struct vm_entry))
+
+/* A contiguous range of user pages with one backing, such as an
+   executable segment, the stack or a file mapping.  Each process
+   keeps its regions in an AVL tree ordered by address.
+
+   The per-page state lives in arrays of vm_entries, one page of
+   entries per chunk, allocated the first time a page of the chunk
+   is looked up.  Entries never move, so frames may point at them.
+
+   Pages [BASE, END) are reserved for the region and no other region
+   may overlap them, but only [START, END) is valid.  The two differ
+   only for the stack, which grows down into its reservation. */
+struct vma
+{
+    uint8_t *base;  /* Reserved start, the tree key. */
+    uint8_t *start; /* First valid page. */
+    uint8_t *end;   /* End of the last page. */
+
+    enum vm_type type;
+    struct file *file;  /* Backing file, or a null pointer. */
+    off_t offset;       /* File offset of BASE. */
+    size_t read_bytes;  /* Bytes of FILE from OFFSET, zeros after. */
+    bool writable;
+    int mapid;  /* Mapping id if made by mmap(), otherwise -1. */
+    int advice; /* MADV_NORMAL, MADV_RANDOM or MADV_SEQUENTIAL. */
+
+    struct vm_entry **chunks; /* Per-page state, VMA_CHUNK_PAGES each. */
+    size_t chunk_cnt;
+
+    struct vma *left, *right; /* Tree links. */
+    int height;               /* Height of the subtree. */
+    struct list_elem mmap_elem;
+};
+
+void vm_init(struct vma **vm);
+void vm_destory(struct vma **vm);
+struct vma *vma_create(void *start, void *end, enum vm_type type, struct file *file,
+                       off_t offset, size_t read_bytes, bool writable);
+struct vma *find_vma(const void *vaddr);
+bool vma_overlaps(const void *start, const void *end);
+struct vm_entry *find_vme(void *vaddr);
+void mmunmap_file(struct vma *vma);
+
+#endif
@@ -0,0 +1,156 @@
+#include "vm/vmstat.h"
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* VM counters and page fault tracer.
+
+   Every counter is kept for each process, in struct thread, and
+   summed over all processes in GLOBAL.  The tracer keeps the last
+   VMTRACE_SIZE page faults of all processes in a ring.  Both are
+   updated with interrupts off, which is cheaper than a lock for a
+   few words. */
+
+static struct vmstat global;
+static struct vm_trace_event trace[VMTRACE_SIZE];
+static uint64_t trace_cnt; /* Faults recorded so far. */
+
+static int read_trace(struct vm_trace_event *events, size_t size);
+
+/* Adds N to COUNTER of thread T, if T is non-null, and of the
+   global totals. */
+void vmstat_count(struct thread *t, enum vm_counter counter, uint64_t n)
+{
+    enum intr_level old_level = intr_disable();
+    global.counters[counter] += n;
+    if (t != NULL)
+        t->vmstat.counters[counter] += n;
+    intr_set_level(old_level);
+}
+
+/* Subtracts N from COUNTER of thread T, if T is non-null, and of
+   the global totals.  For counters that hold a current amount
+   rather than a number of events. */
+void vmstat_uncount(struct thread *t, enum vm_counter counter, uint64_t n)
+{
+    enum intr_level old_level = intr_disable();
+    global.counters[counter] -= n;
+    if (t != NULL)
+        t->vmstat.counters[counter] -= n;
+    intr_set_level(old_level);
+}
+
+/* Sets COUNTER of thread T to N and moves the global total by as
+   much, for counters that hold a current amount. */
+void vmstat_set(struct thread *t, enum vm_counter counter, uint64_t n)
+{
+    enum intr_level old_level = intr_disable();
+    global.counters[counter] += n - t->vmstat.counters[counter];
+    t->vmstat.counters[counter] = n;
+    intr_set_level(old_level);
+}
+
+/* Returns COUNTER of thread T, or the global total if T is
+   null. */
+uint64_t vmstat_get(struct thread *t, enum vm_counter counter)
+{
+    enum intr_level old_level = intr_disable();
+    uint64_t n = t != NULL ? t->vmstat.counters[counter] : global.counters[counter];
+    intr_set_level(old_level);
+    return n;
+}
+
+/* Accounts and traces a fault by the current thread on the page
+   at VADDR, of TYPE, that started at time stamp START. */
+void vmstat_fault(const void *vaddr, enum vm_type type, bool write, bool success, uint64_t start)
+{
+    static const enum vm_counter type_counter[] = {VMC_FAULT_BIN, VMC_FAULT_FILE, VMC_FAULT_ANON};
+    struct thread *cur = thread_current();
+    uint64_t cycles = timer_cycles() - start;
+
+    vmstat_count(cur, type_counter[type], 1);
+    vmstat_count(cur, VMC_FAULT_CYCLES, cycles);
+
+    enum intr_level old_level = intr_disable();
+    struct vm_trace_event *e = &trace[(size_t)trace_cnt++ % VMTRACE_SIZE];
+    e->tsc = start;
+    e->cycles = cycles < UINT32_MAX ? cycles : UINT32_MAX;
+    e->vaddr = (uintptr_t)pg_round_down(vaddr);
+    e->tid = cur->tid;
+    e->type = type_counter[type];
+    e->flags = (write ? VM_TRACE_WRITE : 0) | (success ? 0 : VM_TRACE_FAILED);
+    intr_set_level(old_level);
+}
+
+/* Copies what WHICH selects, see lib/vmstat.h, into the SIZE bytes
+   at BUFFER.  Returns the number of bytes copied, or -1 if WHICH is
+   invalid. */
+int vmstat_read(int which, void *buffer, size_t size)
+{
+    const struct vmstat *st;
+
+    switch (which)
+    {
+    case VMSTAT_SELF:
+        st = &thread_current()->vmstat;
+        break;
+    case VMSTAT_GLOBAL:
+        st = &global;
+        break;
+    case VMSTAT_TRACE:
+        return read_trace(buffer, size);
+    default:
+        return -1;
+    }
+
+    if (size > sizeof *st)
+        size = sizeof *st;
+
+    enum intr_level old_level = intr_disable();
+    memcpy(buffer, st, size);
+    intr_set_level(old_level);
+    return size;
+}
+
+/* Prints the counters in ST, labelled with NAME. */
+void vmstat_print(const char *name, const struct vmstat *st)
+{
+    const uint64_t *c = st->counters;
+    uint64_t faults = c[VMC_FAULT_BIN] + c[VMC_FAULT_FILE] + c[VMC_FAULT_ANON];
+
+    printf("%s: %llu faults (%llu bin, %llu file, %llu anon), %llu cycles/fault, %llu stack growths\n",
+           name, faults, c[VMC_FAULT_BIN], c[VMC_FAULT_FILE], c[VMC_FAULT_ANON],
+           faults != 0 ? c[VMC_FAULT_CYCLES] / faults : 0, c[VMC_STACK_GROW]);
+    printf("%s: swap %llu in, %llu out, %llu slots held, zswap %llu in, %llu out, %llu evicted, %llu frames scanned\n",
+           name, c[VMC_SWAP_IN], c[VMC_SWAP_OUT], c[VMC_SWAP_SLOTS], c[VMC_ZSWAP_IN], c[VMC_ZSWAP_OUT],
+           c[VMC_EVICT], c[VMC_SCAN]);
+    printf("%s: %llu frames resident, %llu in working set, throttled %llu times\n",
+           name, c[VMC_RSS], c[VMC_WSS], c[VMC_THROTTLE]);
+    if (c[VMC_OOM_KILL] != 0)
+        printf("%s: %llu processes killed out of memory\n", name, c[VMC_OOM_KILL]);
+}
+
+/* Prints the counters summed over all processes. */
+void vmstat_print_stats(void)
+{
+    vmstat_print("VM", &global);
+}
+
+/* Copies the most recent faults, as many as fit in SIZE bytes, to
+   EVENTS, oldest first.  Returns the number of bytes copied. */
+static int read_trace(struct vm_trace_event *events, size_t size)
+{
+    size_t cnt, i;
+
+    enum intr_level old_level = intr_disable();
+    cnt = trace_cnt < VMTRACE_SIZE ? trace_cnt : VMTRACE_SIZE;
+    if (cnt > size / sizeof *events)
+        cnt = size / sizeof *events;
+    for (i = 0; i < cnt; i++)
+        events[i] = trace[(size_t)(trace_cnt - cnt + i) % VMTRACE_SIZE];
+    intr_set_level(old_level);
+
+    return cnt * sizeof *events;
+}
@@ -0,0 +1,23 @@
+#ifndef VM_VMSTAT_H
+#define VM_VMSTAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vmstat.h>
+#include "threads/thread.h"
+#include "vm/page.h"
+
+/* Number of page faults kept by the tracer. */
+#define VMTRACE_SIZE 256
+
+void vmstat_count(struct thread *t, enum vm_counter counter, uint64_t n);
+void vmstat_uncount(struct thread *t, enum vm_counter counter, uint64_t n);
+uint64_t vmstat_get(struct thread *t, enum vm_counter counter);
+void vmstat_set(struct thread *t, enum vm_counter counter, uint64_t n);
+void vmstat_fault(const void *vaddr, enum vm_type type, bool write, bool success, uint64_t start);
+int vmstat_read(int which, void *buffer, size_t size);
+void vmstat_print(const char *name, const struct vmstat *st);
+void vmstat_print_stats(void);
+
+#endif
@@ -0,0 +1,185 @@
+#include "vm/writeback.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+
+/* Writeback of dirty file-mapped pages.
+
+   A kernel thread wakes every WRITEBACK_INTERVAL ticks and writes
+   the dirty VM_FILE pages of every process back to their files, so
+   that eviction, munmap() and exit only have to write what was
+   dirtied since the last pass.  msync() does the same for a range
+   of the caller's mappings on demand.
+
+   Each page is written only up to its READ_BYTES, never past the
+   end of the file.  Pages adjacent in the same file are gathered
+   into RUN_BUFFER and go out in a single write. */
+
+/* Serializes writers and protects RUN_BUFFER and the statistics. */
+static struct lock writeback_lock;
+static uint8_t *run_buffer; /* WRITEBACK_CLUSTER_MAX pages, or null. */
+
+/* Statistics. */
+static unsigned long long page_cnt;  /* Pages written. */
+static unsigned long long write_cnt; /* Writes issued. */
+static unsigned long long pass_cnt;  /* Background passes. */
+
+static thread_func writeback_thread NO_RETURN;
+static size_t claim_dirty(struct page **pages, size_t cnt, struct thread *t, const void *start, const void *end);
+static bool page_order_less(struct page *a, struct page *b);
+
+void writeback_init(void)
+{
+    lock_init(&writeback_lock);
+    run_buffer = palloc_get_multiple(0, WRITEBACK_CLUSTER_MAX);
+    thread_create("writeback", PRI_DEFAULT, writeback_thread, NULL);
+}
+
+/* Writes back the dirty file-mapped pages of thread T in
+   [START, END), or of every thread if T is null.  Pages dirtied
+   again while this runs are left for the next call. */
+void writeback_dirty(struct thread *t, const void *start, const void *end)
+{
+    struct page *pages[WRITEBACK_CLUSTER_MAX];
+    size_t budget, cnt, i;
+
+    lock_acquire(&lru_list.lru_list_lock);
+    budget = lru_list.page_cnt;
+    while (budget > 0)
+    {
+        cnt = claim_dirty(pages, budget < WRITEBACK_CLUSTER_MAX ? budget : WRITEBACK_CLUSTER_MAX, t, start, end);
+        if (cnt == 0)
+            break;
+        budget -= cnt;
+        lock_release(&lru_list.lru_list_lock);
+
+        writeback_cluster(pages, cnt);
+
+        lock_acquire(&lru_list.lru_list_lock);
+        for (i = 0; i < cnt; i++)
+            pages[i]->in_transit = pages[i]->vme->in_transit = false;
+        cond_broadcast(&lru_list.transit_cond, &lru_list.lru_list_lock);
+    }
+    lock_release(&lru_list.lru_list_lock);
+}
+
+/* Writes the CNT file-mapped frames in PAGES to their files,
+   sorting PAGES by file position.  The caller must keep the frames
+   from changing hands meanwhile. */
+void writeback_cluster(struct page **pages, size_t cnt)
+{
+    size_t i, j;
+
+    ASSERT(cnt <= WRITEBACK_CLUSTER_MAX);
+
+    /* Insertion sort, the cluster is tiny. */
+    for (i = 1; i < cnt; i++)
+    {
+        struct page *p = pages[i];
+        for (j = i; j > 0 && page_order_less(p, pages[j - 1]); j--)
+            pages[j] = pages[j - 1];
+        pages[j] = p;
+    }
+
+    lock_acquire(&writeback_lock);
+    for (i = 0; i < cnt; i = j)
+    {
+        struct vm_entry *vme = pages[i]->vme;
+        size_t length = vme->read_bytes;
+
+        /* Extend the run while the next page follows in the file.
+           Only the last page of a file can be partial. */
+        for (j = i + 1; j < cnt && run_buffer != NULL && vme->read_bytes == PGSIZE; j++)
+        {
+            struct vm_entry *next = pages[j]->vme;
+            if (file_get_inode(next->file) != file_get_inode(vme->file) || next->offset != vme->offset + PGSIZE)
+                break;
+            vme = next;
+            length += vme->read_bytes;
+        }
+
+        vme = pages[i]->vme;
+        if (j - i == 1)
+            file_write_at(vme->file, pages[i]->kaddr, length, vme->offset);
+        else
+        {
+            size_t k;
+            for (k = i; k < j; k++)
+                memcpy(run_buffer + (k - i) * PGSIZE, pages[k]->kaddr, pages[k]->vme->read_bytes);
+            file_write_at(vme->file, run_buffer, length, vme->offset);
+        }
+
+        page_cnt += j - i;
+        write_cnt++;
+    }
+    lock_release(&writeback_lock);
+}
+
+/* Prints how many mapped pages were written back and in how many
+   writes. */
+void writeback_print_stats(void)
+{
+    printf("Writeback: %llu pages in %llu writes, %llu background passes\n",
+           page_cnt, write_cnt, pass_cnt);
+}
+
+static void writeback_thread(void *aux UNUSED)
+{
+    for (;;)
+    {
+        timer_sleep(WRITEBACK_INTERVAL);
+        writeback_dirty(NULL, NULL, NULL);
+
+        lock_acquire(&writeback_lock);
+        pass_cnt++;
+        lock_release(&writeback_lock);
+    }
+}
+
+/* Claims up to CNT dirty file-mapped frames, only those of thread T
+   in [START, END) if T is non-null.  Clears their dirty bits and
+   marks them in transit, so that they are neither evicted nor
+   unmapped until written.  Must be called with lru_list_lock
+   held. */
+static size_t claim_dirty(struct page **pages, size_t cnt, struct thread *t, const void *start, const void *end)
+{
+    struct list_elem *e;
+    size_t n = 0;
+
+    for (e = list_begin(&lru_list.page_list); e != list_end(&lru_list.page_list) && n < cnt; e = list_next(e))
+    {
+        struct page *page = list_entry(e, struct page, lru);
+        struct vm_entry *vme = page->vme;
+
+        if (vme == NULL || vme->type != VM_FILE || page->in_transit || vme->in_transit)
+            continue;
+        if (t != NULL && (page->thread != t || vme->vaddr < (const uint8_t *)start || vme->vaddr >= (const uint8_t *)end))
+            continue;
+        if (!pagedir_is_dirty(page->thread->pagedir, vme->vaddr))
+            continue;
+
+        /* Clear the bit first, so that a store made during the write
+           dirties the page again. */
+        pagedir_set_dirty(page->thread->pagedir, vme->vaddr, false);
+        page->in_transit = vme->in_transit = true;
+        pages[n++] = page;
+    }
+    return n;
+}
+
+static bool page_order_less(struct page *a, struct page *b)
+{
+    struct inode *inode_a = file_get_inode(a->vme->file);
+    struct inode *inode_b = file_get_inode(b->vme->file);
+
+    if (inode_a != inode_b)
+        return inode_a < inode_b;
+    return a->vme->offset < b->vme->offset;
+}
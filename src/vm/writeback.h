@@ -0,0 +1,20 @@
+#ifndef VM_WRITEBACK_H
+#define VM_WRITEBACK_H
+
+#include <stddef.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "vm/page.h"
+
+/* Ticks between background writeback passes. */
+#define WRITEBACK_INTERVAL (5 * TIMER_FREQ)
+
+/* Maximum number of pages written together. */
+#define WRITEBACK_CLUSTER_MAX 8
+
+void writeback_init(void);
+void writeback_dirty(struct thread *t, const void *start, const void *end);
+void writeback_cluster(struct page **pages, size_t cnt);
+void writeback_print_stats(void);
+
+#endif
@@ -0,0 +1,161 @@
+#include "vm/wss.h"
+#include <list.h>
+#include "threads/interrupt.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/vmstat.h"
+
+/* Working set sampling.
+
+   A kernel thread wakes every WSS_INTERVAL ticks and walks the
+   frame list.  A process's resident set is the number of frames
+   it owns.  Its working set is estimated from the frames it
+   accessed since the previous sample, averaged over about
+   WSS_WEIGHT samples.  The sampler clears accessed bits so that
+   the next sample sees only new accesses, but saves them in the
+   frame's REFERENCED flag for the clock in find_victim().
+
+   Eviction uses the estimates to leave each process its fair share
+   of the frames where it can.  A process that reads back more
+   pages per interval than it keeps resident is thrashing, and is
+   made to wait before it takes a frame from anyone else. */
+
+/* Frames per user process at the last sample. */
+static size_t fair_share;
+
+/* User processes holding more than FAIR_SHARE frames. */
+static size_t over_share_cnt;
+
+static thread_func wss_thread NO_RETURN;
+static void wss_sample(void);
+static void begin_sample(struct thread *t, void *aux);
+static void end_sample(struct thread *t, void *aux);
+static void count_over_share(struct thread *t, void *aux);
+
+void wss_init(void)
+{
+    fair_share = SIZE_MAX;
+    over_share_cnt = 0;
+    thread_create("wss", PRI_DEFAULT, wss_thread, NULL);
+}
+
+/* Returns true if user process T holds no more than its fair share
+   of the frames. */
+bool wss_within_share(struct thread *t)
+{
+    return t->vmstat.counters[VMC_RSS] <= fair_share;
+}
+
+/* Returns true if some user process holds more than its fair
+   share of the frames. */
+bool wss_any_over_share(void)
+{
+    return over_share_cnt > 0;
+}
+
+/* Makes the current process wait a little if it is thrashing, so
+   that others can run with the frames they have. */
+void wss_throttle(void)
+{
+    struct thread *cur = thread_current();
+    if (cur->thrashing)
+    {
+        vmstat_count(cur, VMC_THROTTLE, 1);
+        timer_sleep(WSS_THROTTLE_TICKS);
+    }
+}
+
+/* Drops exiting process T's resident and working set from the
+   global totals. */
+void wss_exit(struct thread *t)
+{
+    enum intr_level old_level = intr_disable();
+    if (!wss_within_share(t) && over_share_cnt > 0)
+        over_share_cnt--;
+    intr_set_level(old_level);
+
+    vmstat_set(t, VMC_RSS, 0);
+    vmstat_set(t, VMC_WSS, 0);
+}
+
+static void wss_thread(void *aux UNUSED)
+{
+    for (;;)
+    {
+        timer_sleep(WSS_INTERVAL);
+        wss_sample();
+    }
+}
+
+/* Takes one sample of every user process's frames. */
+static void wss_sample(void)
+{
+    struct list_elem *e;
+    size_t proc_cnt = 0;
+    enum intr_level old_level;
+
+    lock_acquire(&lru_list.lru_list_lock);
+
+    old_level = intr_disable();
+    thread_foreach(begin_sample, NULL);
+    intr_set_level(old_level);
+
+    /* Frames of live processes only, vm_destory() takes them off
+       the list under the lock. */
+    for (e = list_begin(&lru_list.page_list); e != list_end(&lru_list.page_list); e = list_next(e))
+    {
+        struct page *page = list_entry(e, struct page, lru);
+        if (page->thread == NULL || page->in_transit)
+            continue;
+
+        uint32_t *pd = page->thread->pagedir;
+        page->thread->wss_resident++;
+        if (pagedir_is_accessed(pd, page->vme->vaddr))
+        {
+            page->thread->wss_referenced++;
+            pagedir_set_accessed(pd, page->vme->vaddr, false);
+            page->referenced = true;
+        }
+    }
+
+    old_level = intr_disable();
+    thread_foreach(end_sample, &proc_cnt);
+    fair_share = proc_cnt > 0 ? lru_list.page_cnt / proc_cnt : SIZE_MAX;
+    over_share_cnt = 0;
+    thread_foreach(count_over_share, NULL);
+    intr_set_level(old_level);
+
+    lock_release(&lru_list.lru_list_lock);
+}
+
+static void begin_sample(struct thread *t, void *aux UNUSED)
+{
+    t->wss_resident = 0;
+    t->wss_referenced = 0;
+}
+
+/* Publishes the sample of user process T and counts it in the
+   size_t at PROC_CNT. */
+static void end_sample(struct thread *t, void *proc_cnt)
+{
+    if (t->pagedir == NULL)
+        return;
+
+    const uint64_t *c = t->vmstat.counters;
+    uint64_t wss = (c[VMC_WSS] * (WSS_WEIGHT - 1) + t->wss_referenced) / WSS_WEIGHT;
+    uint64_t refaults = c[VMC_SWAP_IN] + c[VMC_ZSWAP_IN];
+
+    vmstat_set(t, VMC_RSS, t->wss_resident);
+    vmstat_set(t, VMC_WSS, wss);
+    t->thrashing = refaults - t->wss_refaults > t->wss_resident;
+    t->wss_refaults = refaults;
+    (*(size_t *)proc_cnt)++;
+}
+
+/* Counts user process T in OVER_SHARE_CNT if it holds more than
+   its fair share. */
+static void count_over_share(struct thread *t, void *aux UNUSED)
+{
+    if (t->pagedir != NULL && !wss_within_share(t))
+        over_share_cnt++;
+}
@@ -0,0 +1,23 @@
+#ifndef VM_WSS_H
+#define VM_WSS_H
+
+#include <stdbool.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+
+/* Ticks between working set samples. */
+#define WSS_INTERVAL (TIMER_FREQ / 4)
+
+/* Samples averaged into a working set estimate. */
+#define WSS_WEIGHT 4
+
+/* Ticks a thrashing process waits before it takes a frame. */
+#define WSS_THROTTLE_TICKS 2
+
+void wss_init(void);
+bool wss_within_share(struct thread *t);
+bool wss_any_over_share(void);
+void wss_throttle(void);
+void wss_exit(struct thread *t);
+
+#endif
@@ -0,0 +1,242 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+#include "vm/vmstat.h"
+
+/* Compressed page pool sitting in front of the swap device.
+
+   Evicted anonymous pages are first offered to zswap_store().  A
+   page whose words are all equal is kept as just that word; any
+   other page is run through a small LZ77 compressor (the LZJB
+   scheme) and kept in a malloc() block if it shrinks to at most
+   ZSWAP_MAX_LENGTH bytes.  Everything else goes to disk. */
+
+/* Compressed format: every group of 8 items is preceded by a copy
+   map byte.  A clear bit is a literal byte, a set bit a 2-byte
+   match of MATCH_BITS length and 16 - MATCH_BITS offset bits. */
+#define MATCH_BITS 6
+#define MATCH_MIN 3
+#define MATCH_MAX ((1 << MATCH_BITS) + (MATCH_MIN - 1))
+#define OFFSET_MASK ((1 << (16 - MATCH_BITS)) - 1)
+#define LEMPEL_SIZE 1024
+
+static struct lock zswap_lock;
+static struct lock_class zswap_lock_class = LOCK_CLASS_INITIALIZER("zswap", 0);
+
+/* Scratch space, protected by zswap_lock. */
+static uint8_t zswap_buf[ZSWAP_MAX_LENGTH];
+static uint16_t lempel[LEMPEL_SIZE];
+
+/* Statistics. */
+static size_t pool_bytes;                /* Compressed bytes currently held. */
+static unsigned long long stored_cnt;    /* Pages accepted. */
+static unsigned long long same_fill_cnt; /* Of those, same-filled pages. */
+static unsigned long long stored_bytes;  /* Compressed bytes accepted. */
+static unsigned long long reject_cnt;    /* Pages sent on to disk. */
+static unsigned long long load_cnt;      /* Faults served from the pool. */
+
+static bool same_filled(const void *kaddr, uint32_t *fill);
+static size_t compress(const uint8_t *src, uint8_t *dst, size_t limit);
+static void decompress(const uint8_t *src, uint8_t *dst);
+
+void zswap_init(void)
+{
+    lock_init_class(&zswap_lock, &zswap_lock_class);
+}
+
+/* Tries to keep the page at KADDR in the pool.  Returns its entry,
+   or a null pointer if the page does not compress well enough or
+   the pool is full. */
+struct zswap_entry *zswap_store(const void *kaddr)
+{
+    struct zswap_entry *entry = malloc(sizeof *entry);
+    if (entry == NULL)
+        return NULL;
+
+    entry->length = 0;
+    entry->data = NULL;
+    if (same_filled(kaddr, &entry->fill))
+    {
+        lock_acquire(&zswap_lock);
+        stored_cnt++;
+        same_fill_cnt++;
+        lock_release(&zswap_lock);
+        return entry;
+    }
+
+    lock_acquire(&zswap_lock);
+    size_t length = compress(kaddr, zswap_buf, ZSWAP_MAX_LENGTH);
+    if (length != 0 && pool_bytes + length <= ZSWAP_POOL_MAX)
+        entry->data = malloc(length);
+
+    if (entry->data == NULL)
+    {
+        reject_cnt++;
+        lock_release(&zswap_lock);
+        free(entry);
+        return NULL;
+    }
+
+    memcpy(entry->data, zswap_buf, length);
+    entry->length = length;
+    pool_bytes += length;
+    stored_cnt++;
+    stored_bytes += length;
+    lock_release(&zswap_lock);
+
+    return entry;
+}
+
+/* Restores the page held in ENTRY into KADDR and frees ENTRY. */
+void zswap_load(struct zswap_entry *entry, void *kaddr)
+{
+    if (entry->length == 0)
+    {
+        uint32_t *p = kaddr;
+        for (size_t i = 0; i < PGSIZE / sizeof *p; i++)
+            p[i] = entry->fill;
+    }
+    else
+        decompress(entry->data, kaddr);
+
+    lock_acquire(&zswap_lock);
+    load_cnt++;
+    lock_release(&zswap_lock);
+    vmstat_count(thread_current(), VMC_ZSWAP_IN, 1);
+
+    zswap_free(entry);
+}
+
+/* Drops ENTRY without restoring it. */
+void zswap_free(struct zswap_entry *entry)
+{
+    if (entry->data != NULL)
+    {
+        lock_acquire(&zswap_lock);
+        pool_bytes -= entry->length;
+        lock_release(&zswap_lock);
+        free(entry->data);
+    }
+    free(entry);
+}
+
+/* Prints compression ratio and hit rate of the pool. */
+void zswap_print_stats(void)
+{
+    unsigned long long swap_in_cnt = swap_partition.swap_in_cnt;
+    unsigned long long fault_cnt = load_cnt + swap_in_cnt;
+    unsigned long long compressed_cnt = stored_cnt - same_fill_cnt;
+
+    printf("Zswap: %llu pages stored (%llu same-filled), %llu rejected, %zu bytes held\n",
+           stored_cnt, same_fill_cnt, reject_cnt, pool_bytes);
+    printf("Zswap: compression ratio %llu%%, hit rate %llu%% (%llu of %llu swap-ins)\n",
+           compressed_cnt != 0 ? compressed_cnt * PGSIZE * 100 / stored_bytes : 0,
+           fault_cnt != 0 ? load_cnt * 100 / fault_cnt : 0,
+           load_cnt, fault_cnt);
+}
+
+/* Returns true if every word of the page at KADDR is the same,
+   storing that word in *FILL. */
+static bool same_filled(const void *kaddr, uint32_t *fill)
+{
+    const uint32_t *p = kaddr;
+    for (size_t i = 1; i < PGSIZE / sizeof *p; i++)
+        if (p[i] != p[0])
+            return false;
+
+    *fill = p[0];
+    return true;
+}
+
+/* Compresses the page at SRC into DST.  Returns the compressed
+   length, or 0 if it would exceed LIMIT bytes. */
+static size_t compress(const uint8_t *src, uint8_t *dst, size_t limit)
+{
+    const uint8_t *s = src;
+    const uint8_t *end = src + PGSIZE;
+    uint8_t *d = dst;
+    uint8_t *copymap = NULL;
+    int copymask = 1 << 7;
+
+    memset(lempel, 0, sizeof lempel);
+    while (s < end)
+    {
+        if ((copymask <<= 1) == (1 << 8))
+        {
+            /* Room for a map byte and 8 worst-case items. */
+            if (d + 1 + 2 * 8 > dst + limit)
+                return 0;
+            copymask = 1;
+            copymap = d;
+            *d++ = 0;
+        }
+
+        if (s > end - MATCH_MAX)
+        {
+            *d++ = *s++;
+            continue;
+        }
+
+        unsigned hash = (s[0] << 16) + (s[1] << 8) + s[2];
+        hash += hash >> 9;
+        hash += hash >> 5;
+        uint16_t *hp = &lempel[hash & (LEMPEL_SIZE - 1)];
+        size_t pos = s - src;
+        size_t offset = pos - *hp;
+        *hp = pos;
+
+        const uint8_t *cpy = s - offset;
+        if (offset != 0 && offset <= OFFSET_MASK && cpy[0] == s[0] && cpy[1] == s[1] && cpy[2] == s[2])
+        {
+            int mlen;
+            *copymap |= copymask;
+            for (mlen = MATCH_MIN; mlen < MATCH_MAX; mlen++)
+                if (s[mlen] != cpy[mlen])
+                    break;
+            *d++ = ((mlen - MATCH_MIN) << (16 - MATCH_BITS - 8)) | (offset >> 8);
+            *d++ = (uint8_t)offset;
+            s += mlen;
+        }
+        else
+            *d++ = *s++;
+    }
+
+    return d - dst;
+}
+
+/* Decompresses SRC, produced by compress(), into the page at DST. */
+static void decompress(const uint8_t *src, uint8_t *dst)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint8_t *end = dst + PGSIZE;
+    int copymap = 0;
+    int copymask = 1 << 7;
+
+    while (d < end)
+    {
+        if ((copymask <<= 1) == (1 << 8))
+        {
+            copymask = 1;
+            copymap = *s++;
+        }
+
+        if (copymap & copymask)
+        {
+            int mlen = (s[0] >> (16 - MATCH_BITS - 8)) + MATCH_MIN;
+            size_t offset = ((s[0] << 8) | s[1]) & OFFSET_MASK;
+            const uint8_t *cpy = d - offset;
+            s += 2;
+            ASSERT(cpy >= dst);
+            while (mlen-- > 0 && d < end)
+                *d++ = *cpy++;
+        }
+        else
+            *d++ = *s++;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Largest compressed page kept in the pool.  Bigger results would
+   not fit a malloc() block smaller than a page. */
+#define ZSWAP_MAX_LENGTH 1024
+
+/* Upper bound on compressed bytes held by the pool. */
+#define ZSWAP_POOL_MAX (128 * 1024)
+
+/* A page held in the compressed pool. */
+struct zswap_entry
+{
+    size_t length; /* Compressed length, 0 for a same-filled page. */
+    uint32_t fill; /* Fill word of a same-filled page. */
+    uint8_t *data; /* Compressed contents. */
+};
+
+void zswap_init(void);
+struct zswap_entry *zswap_store(const void *kaddr);
+void zswap_load(struct zswap_entry *entry, void *kaddr);
+void zswap_free(struct zswap_entry *entry);
+void zswap_print_stats(void);
+
+#endif